@@ -1,16 +1,21 @@
 #include "bsm.h"
 
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
 
 #ifdef BIGENDIAN
 #define BYTEFLIP32(x) (((x) & 0x000000FF) << 24 | ((x) & 0x0000FF00) << 8 | ((x) & 0x00FF0000) >> 8 | ((x) & 0xFF000000) >> 24)
+#define BYTEFLIP64(x) ((uint64_t)BYTEFLIP32((uint32_t)(x)) << 32 | BYTEFLIP32((uint32_t)((x) >> 32)))
 #else
 #define BYTEFLIP32(x) (x)
+#define BYTEFLIP64(x) (x)
 #endif
 
-#define ASSERT_PACKING(x) assert(sizeof(x##_t) == x##_size);
+/* the structs are copied to and from files byte for byte, so their layout is checked at compile time -- C99 has no
+ * static_assert, so a mismatch declares an array of negative size instead */
+#define ASSERT_PACKING(x, size) typedef char x##_packing[sizeof(x##_t) == (size) ? 1 : -1];
 
 const int32_t bsm_magic[4] = {
   0x414E4942,
@@ -19,31 +24,94 @@ const int32_t bsm_magic[4] = {
   0x4853454D
 };
 
-static const size_t bsm_header_v1_size = 0x84;
-static const size_t bsm_position_size  = 0x0C;
-static const size_t bsm_texcoord_size  = 0x08;
-static const size_t bsm_normal_size    = 0x0C;
-static const size_t bsm_tangent_size   = 0x10;
-static const size_t bsm_triangle_size  = 0x0C;
-static const size_t bsm_mesh_size      = 0x108;
-static const size_t bsm_hullvert_size  = 0x0C;
-static const size_t bsm_hull_size      = 0x08;
-static const size_t bsm_visvert_size   = 0x0C;
-static const size_t bsm_vistri_size    = 0x0C;
+ASSERT_PACKING(bsm_header_v1, 0x84)
+ASSERT_PACKING(bsm_position, 0x0C)
+ASSERT_PACKING(bsm_texcoord, 0x08)
+ASSERT_PACKING(bsm_normal, 0x0C)
+ASSERT_PACKING(bsm_tangent, 0x10)
+ASSERT_PACKING(bsm_triangle, 0x0C)
+ASSERT_PACKING(bsm_mesh, 0x108)
+ASSERT_PACKING(bsm_hullvert, 0x0C)
+ASSERT_PACKING(bsm_hull, 0x08)
+ASSERT_PACKING(bsm_visvert, 0x0C)
+ASSERT_PACKING(bsm_vistri, 0x0C)
+ASSERT_PACKING(bsm_vertrange, 0x08)
+ASSERT_PACKING(bsm_header_ext_vertranges, 0x8C)
+ASSERT_PACKING(bsm_hulltopo, 0x10)
+ASSERT_PACKING(bsm_hullface, 0x18)
+ASSERT_PACKING(bsm_hulledge, 0x0C)
+ASSERT_PACKING(bsm_header_ext_hulls, 0x9C)
+ASSERT_PACKING(bsm_header_ext_64, 0x110)
+ASSERT_PACKING(bsm_tile, 0x30)
+ASSERT_PACKING(bsm_header_ext_tiles, 0x8C)
+
+static const size_t bsm_chunk_sizes[BSM_NUM_CHUNKS] = {
+  sizeof(bsm_position_t), sizeof(bsm_texcoord_t), sizeof(bsm_normal_t), sizeof(bsm_tangent_t), sizeof(bsm_triangle_t),
+  sizeof(bsm_mesh_t), sizeof(bsm_hullvert_t), sizeof(bsm_hull_t), sizeof(bsm_visvert_t), sizeof(bsm_vistri_t)
+};
 
 static void reordercpy32(void *dst, const void *src, size_t bytes) {
   assert(bytes % 4 == 0);
   
-  uint32_t *src32 = src;
-  uint32_t *dst32 = dst;
+  const uint8_t *src8 = src;
+  uint8_t *dst8 = dst;
   uint32_t x;
-  for (int i = 0; i < bytes / 4; i++) {
-    memcpy(&x, &src32[i], 4);
+  for (size_t i = 0; i < bytes; i += 4) {
+    memcpy(&x, &src8[i], 4);
     x = BYTEFLIP32(x);
-    dst32[i] = x;
+    memcpy(&dst8[i], &x, 4);
   }
 }
 
+static void reordercpy64(void *dst, const void *src, size_t bytes) {
+  assert(bytes % 8 == 0);
+  
+  const uint8_t *src8 = src;
+  uint8_t *dst8 = dst;
+  uint64_t x;
+  for (size_t i = 0; i < bytes; i += 8) {
+    memcpy(&x, &src8[i], 8);
+    x = BYTEFLIP64(x);
+    memcpy(&dst8[i], &x, 8);
+  }
+}
+
+/* overflow-proof: offs + bytes <= n */
+static bool in_bounds(uint64_t offs, uint64_t bytes, size_t n) {
+  return offs <= n && bytes <= n - offs;
+}
+
+/* a chunk of count elements of the given size at offs lies within n bytes, without ever forming count * size + offs */
+static bool chunk_fits(int64_t count, size_t size, int64_t offs, size_t n) {
+  if (count < 0 || offs < 0 || (uint64_t)offs > n) return false;
+  return (uint64_t)count <= (n - (uint64_t)offs) / size;
+}
+
+typedef struct chunk_span {
+  uint64_t offs;
+  uint64_t bytes;
+} chunk_span_t;
+
+static void v1_spans(bsm_header_v1_t *header, chunk_span_t *spans) {
+  for (int c = 0; c < BSM_NUM_CHUNKS; c++) {
+    spans[c].offs  = bsm_chunk_offs(header, c);
+    spans[c].bytes = bsm_chunk_bytes(header, c);
+  }
+}
+
+/* non-empty chunks may neither overlap the header(s) nor each other */
+static bool spans_disjoint(chunk_span_t *spans, int num, uint64_t header_bytes) {
+  for (int i = 0; i < num; i++) {
+    if (spans[i].bytes == 0) continue;
+    if (spans[i].offs < header_bytes) return false;
+    for (int j = i + 1; j < num; j++) {
+      if (spans[j].bytes == 0) continue;
+      if (spans[i].offs < spans[j].offs + spans[j].bytes && spans[j].offs < spans[i].offs + spans[i].bytes) return false;
+    }
+  }
+  return true;
+}
+
 static void normalize_normal(bsm_normal_t *normal) {
   float m = sqrtf(normal->x * normal->x + normal->y * normal->y + normal->z * normal->z);
   normal->x /= m;
@@ -60,8 +128,6 @@ static void normalize_tangent(bsm_tangent_t *tangent) {
 }
 
 bool bsm_read_header_v1(uint8_t *data, size_t n, bsm_header_v1_t *header) {
-  ASSERT_PACKING(bsm_header_v1);
-  
   if (n < sizeof(bsm_header_v1_t)) return false;
   
   reordercpy32(header, data, sizeof(bsm_header_v1_t));
@@ -87,44 +153,75 @@ bool bsm_read_header_v1(uint8_t *data, size_t n, bsm_header_v1_t *header) {
   if (header->offs_visverts < 0) return false;
   if (header->num_vistris < 0) return false;
   if (header->offs_vistris < 0) return false;
-  if (header->num_verts * sizeof(bsm_position_t) + header->offs_positions > n) return false;
-  if (header->num_verts * sizeof(bsm_texcoord_t) + header->offs_texcoords > n) return false;
-  if (header->num_verts * sizeof(bsm_normal_t) + header->offs_normals > n) return false;
-  if (header->num_verts * sizeof(bsm_tangent_t) + header->offs_tangents > n) return false;
-  if (header->num_tris * sizeof(bsm_triangle_t) + header->offs_tris > n) return false;
-  if (header->num_meshes * sizeof(bsm_mesh_t) + header->offs_meshes > n) return false;
-  if (header->num_hullverts * sizeof(bsm_hullvert_t) + header->offs_hullverts > n) return false;
-  if (header->num_hulls * sizeof(bsm_hull_t) + header->offs_hulls > n) return false;
-  if (header->num_visverts * sizeof(bsm_visvert_t) + header->offs_visverts > n) return false;
-  if (header->num_vistris * sizeof(bsm_vistri_t) + header->offs_vistris > n) return false;
-  /* TODO: check for overlapping chunks */
+  if (!chunk_fits(header->num_verts, sizeof(bsm_position_t), header->offs_positions, n)) return false;
+  if (!chunk_fits(header->num_verts, sizeof(bsm_texcoord_t), header->offs_texcoords, n)) return false;
+  if (!chunk_fits(header->num_verts, sizeof(bsm_normal_t), header->offs_normals, n)) return false;
+  if (!chunk_fits(header->num_verts, sizeof(bsm_tangent_t), header->offs_tangents, n)) return false;
+  if (!chunk_fits(header->num_tris, sizeof(bsm_triangle_t), header->offs_tris, n)) return false;
+  if (!chunk_fits(header->num_meshes, sizeof(bsm_mesh_t), header->offs_meshes, n)) return false;
+  if (!chunk_fits(header->num_hullverts, sizeof(bsm_hullvert_t), header->offs_hullverts, n)) return false;
+  if (!chunk_fits(header->num_hulls, sizeof(bsm_hull_t), header->offs_hulls, n)) return false;
+  if (!chunk_fits(header->num_visverts, sizeof(bsm_visvert_t), header->offs_visverts, n)) return false;
+  if (!chunk_fits(header->num_vistris, sizeof(bsm_vistri_t), header->offs_vistris, n)) return false;
+  
+  chunk_span_t spans[BSM_NUM_CHUNKS];
+  v1_spans(header, spans);
+  if (!spans_disjoint(spans, BSM_NUM_CHUNKS, sizeof(bsm_header_v1_t))) return false;
   return true;
 }
 
+size_t bsm_chunk_offs(bsm_header_v1_t *header, bsm_chunk_t chunk) {
+  switch (chunk) {
+    case BSM_CHUNK_POSITIONS: return header->offs_positions;
+    case BSM_CHUNK_TEXCOORDS: return header->offs_texcoords;
+    case BSM_CHUNK_NORMALS:   return header->offs_normals;
+    case BSM_CHUNK_TANGENTS:  return header->offs_tangents;
+    case BSM_CHUNK_TRIS:      return header->offs_tris;
+    case BSM_CHUNK_MESHES:    return header->offs_meshes;
+    case BSM_CHUNK_HULLVERTS: return header->offs_hullverts;
+    case BSM_CHUNK_HULLS:     return header->offs_hulls;
+    case BSM_CHUNK_VISVERTS:  return header->offs_visverts;
+    case BSM_CHUNK_VISTRIS:   return header->offs_vistris;
+    default:                  return 0;
+  }
+}
+
+size_t bsm_chunk_bytes(bsm_header_v1_t *header, bsm_chunk_t chunk) {
+  switch (chunk) {
+    case BSM_CHUNK_POSITIONS: return bsm_positions_bytes(header);
+    case BSM_CHUNK_TEXCOORDS: return bsm_texcoords_bytes(header);
+    case BSM_CHUNK_NORMALS:   return bsm_normals_bytes(header);
+    case BSM_CHUNK_TANGENTS:  return bsm_tangents_bytes(header);
+    case BSM_CHUNK_TRIS:      return bsm_tris_bytes(header);
+    case BSM_CHUNK_MESHES:    return bsm_meshes_bytes(header);
+    case BSM_CHUNK_HULLVERTS: return bsm_hullverts_bytes(header);
+    case BSM_CHUNK_HULLS:     return bsm_hulls_bytes(header);
+    case BSM_CHUNK_VISVERTS:  return bsm_visverts_bytes(header);
+    case BSM_CHUNK_VISTRIS:   return bsm_vistris_bytes(header);
+    default:                  return 0;
+  }
+}
+
 size_t bsm_positions_bytes(bsm_header_v1_t *header) {
-  ASSERT_PACKING(bsm_position);
   return header->num_verts * sizeof(bsm_position_t);
 }
 
 size_t bsm_texcoords_bytes(bsm_header_v1_t *header) {
-  ASSERT_PACKING(bsm_texcoord);
   return header->num_verts * sizeof(bsm_texcoord_t);
 }
 
 size_t bsm_normals_bytes(bsm_header_v1_t *header) {
-  ASSERT_PACKING(bsm_normal);
   return header->num_verts * sizeof(bsm_normal_t);
 }
 
 size_t bsm_tangents_bytes(bsm_header_v1_t *header) {
-  ASSERT_PACKING(bsm_tangent);
   return header->num_verts * sizeof(bsm_tangent_t);
 }
 
 bool bsm_read_positions(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_position_t *positions) {
   size_t bytes = bsm_positions_bytes(header);
   size_t offs  = header->offs_positions;
-  if (offs + bytes > n) return false;
+  if (!in_bounds(offs, bytes, n)) return false;
   
   reordercpy32(positions, data + offs, bytes);
   return true;
@@ -133,7 +230,7 @@ bool bsm_read_positions(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_po
 bool bsm_read_texcoords(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_texcoord_t *texcoords) {
   size_t bytes = bsm_texcoords_bytes(header);
   size_t offs  = header->offs_texcoords;
-  if (offs + bytes > n) return false;
+  if (!in_bounds(offs, bytes, n)) return false;
   
   reordercpy32(texcoords, data + offs, bytes);
   return true;
@@ -142,10 +239,10 @@ bool bsm_read_texcoords(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_te
 bool bsm_read_normals(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_normal_t *normals) {
   size_t bytes = bsm_normals_bytes(header);
   size_t offs  = header->offs_normals;
-  if (offs + bytes > n) return false;
+  if (!in_bounds(offs, bytes, n)) return false;
   
   reordercpy32(normals, data + offs, bytes);
-  for (int i = 0; i < header->num_verts; i++) {
+  for (int32_t i = 0; i < header->num_verts; i++) {
     normalize_normal(&normals[i]);
   }
   return true;
@@ -154,67 +251,61 @@ bool bsm_read_normals(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_norm
 bool bsm_read_tangents(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_tangent_t *tangents) {
   size_t bytes = bsm_tangents_bytes(header);
   size_t offs  = header->offs_tangents;
-  if (offs + bytes > n) return false;
+  if (!in_bounds(offs, bytes, n)) return false;
   
   reordercpy32(tangents, data + offs, bytes);
-  for (int i = 0; i < header->num_verts; i++) {
+  for (int32_t i = 0; i < header->num_verts; i++) {
     normalize_tangent(&tangents[i]);
   }
   return true;
 }
 
 size_t bsm_tris_bytes(bsm_header_v1_t *header) {
-  ASSERT_PACKING(bsm_triangle);
   return header->num_tris * sizeof(bsm_triangle_t);
 }
 
 bool bsm_read_tris(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_triangle_t *tris) {
   size_t bytes = bsm_tris_bytes(header);
   size_t offs  = header->offs_tris;
-  if (offs + bytes > n) return false;
+  if (!in_bounds(offs, bytes, n)) return false;
   
   reordercpy32(tris, data + offs, bytes);
   return true;
 }
 
 size_t bsm_meshes_bytes(bsm_header_v1_t *header) {
-  ASSERT_PACKING(bsm_mesh);
   return header->num_meshes * sizeof(bsm_mesh_t);
 }
 
 bool bsm_read_meshes(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_mesh_t *meshes) {
   size_t bytes = bsm_meshes_bytes(header);
   size_t offs  = header->offs_meshes;
-  if (offs + bytes > n) return false;
+  if (!in_bounds(offs, bytes, n)) return false;
   
   reordercpy32(meshes, data + offs, bytes);
   return true;
 }
 
 size_t bsm_hullverts_bytes(bsm_header_v1_t *header) {
-  ASSERT_PACKING(bsm_hullvert);
   return header->num_hullverts * sizeof(bsm_hullvert_t);
 }
 
 size_t bsm_hulls_bytes(bsm_header_v1_t *header) {
-  ASSERT_PACKING(bsm_hull);
   return header->num_hulls * sizeof(bsm_hull_t);
 }
 
 size_t bsm_visverts_bytes(bsm_header_v1_t *header) {
-  ASSERT_PACKING(bsm_visvert);
   return header->num_visverts * sizeof(bsm_visvert_t);
 }
 
 size_t bsm_vistris_bytes(bsm_header_v1_t *header) {
-  ASSERT_PACKING(bsm_vistri);
   return header->num_vistris * sizeof(bsm_vistri_t);
 }
 
 bool bsm_read_hullverts(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_hullvert_t *hullverts) {
   size_t bytes = bsm_hullverts_bytes(header);
   size_t offs  = header->offs_hullverts;
-  if (offs + bytes > n) return false;
+  if (!in_bounds(offs, bytes, n)) return false;
   
   reordercpy32(hullverts, data + offs, bytes);
   return true;
@@ -223,7 +314,7 @@ bool bsm_read_hullverts(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_hu
 bool bsm_read_hulls(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_hull_t *hulls) {
   size_t bytes = bsm_hulls_bytes(header);
   size_t offs  = header->offs_hulls;
-  if (offs + bytes > n) return false;
+  if (!in_bounds(offs, bytes, n)) return false;
   
   reordercpy32(hulls, data + offs, bytes);
   return true;
@@ -232,7 +323,7 @@ bool bsm_read_hulls(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_hull_t
 bool bsm_read_visverts(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_visvert_t *visverts) {
   size_t bytes = bsm_visverts_bytes(header);
   size_t offs  = header->offs_visverts;
-  if (offs + bytes > n) return false;
+  if (!in_bounds(offs, bytes, n)) return false;
   
   reordercpy32(visverts, data + offs, bytes);
   return true;
@@ -241,8 +332,786 @@ bool bsm_read_visverts(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_vis
 bool bsm_read_vistris(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_vistri_t *vistris) {
   size_t bytes = bsm_vistris_bytes(header);
   size_t offs  = header->offs_vistris;
-  if (offs + bytes > n) return false;
+  if (!in_bounds(offs, bytes, n)) return false;
   
   reordercpy32(vistris, data + offs, bytes);
   return true;
-}
\ No newline at end of file
+}
+
+bool bsm_alloc_model(bsm_model_t *model) {
+  bsm_header_v1_t *header = &model->header;
+  /* one spare byte keeps empty chunks from returning NULL */
+  model->positions = calloc(1, bsm_positions_bytes(header) + 1);
+  model->texcoords = calloc(1, bsm_texcoords_bytes(header) + 1);
+  model->normals   = calloc(1, bsm_normals_bytes(header) + 1);
+  model->tangents  = calloc(1, bsm_tangents_bytes(header) + 1);
+  model->tris      = calloc(1, bsm_tris_bytes(header) + 1);
+  model->meshes    = calloc(1, bsm_meshes_bytes(header) + 1);
+  model->hullverts = calloc(1, bsm_hullverts_bytes(header) + 1);
+  model->hulls     = calloc(1, bsm_hulls_bytes(header) + 1);
+  model->visverts  = calloc(1, bsm_visverts_bytes(header) + 1);
+  model->vistris   = calloc(1, bsm_vistris_bytes(header) + 1);
+  if (model->positions && model->texcoords && model->normals && model->tangents && model->tris &&
+      model->meshes && model->hullverts && model->hulls && model->visverts && model->vistris) return true;
+  bsm_free_model(model);
+  return false;
+}
+
+void bsm_free_model(bsm_model_t *model) {
+  free(model->positions);
+  free(model->texcoords);
+  free(model->normals);
+  free(model->tangents);
+  free(model->tris);
+  free(model->meshes);
+  free(model->hullverts);
+  free(model->hulls);
+  free(model->visverts);
+  free(model->vistris);
+  model->positions = NULL;
+  model->texcoords = NULL;
+  model->normals   = NULL;
+  model->tangents  = NULL;
+  model->tris      = NULL;
+  model->meshes    = NULL;
+  model->hullverts = NULL;
+  model->hulls     = NULL;
+  model->visverts  = NULL;
+  model->vistris   = NULL;
+}
+
+bool bsm_read_model(uint8_t *data, size_t n, bsm_model_t *model) {
+  if (!bsm_read_header_v1(data, n, &model->header)) return false;
+  if (!bsm_alloc_model(model)) return false;
+  
+  bsm_header_v1_t *header = &model->header;
+  if (bsm_read_positions(data, n, header, model->positions) &&
+      bsm_read_texcoords(data, n, header, model->texcoords) &&
+      bsm_read_normals(data, n, header, model->normals) &&
+      bsm_read_tangents(data, n, header, model->tangents) &&
+      bsm_read_tris(data, n, header, model->tris) &&
+      bsm_read_meshes(data, n, header, model->meshes) &&
+      bsm_read_hullverts(data, n, header, model->hullverts) &&
+      bsm_read_hulls(data, n, header, model->hulls) &&
+      bsm_read_visverts(data, n, header, model->visverts) &&
+      bsm_read_vistris(data, n, header, model->vistris)) return true;
+  bsm_free_model(model);
+  return false;
+}
+
+bool bsm_read_header_ext_vertranges(uint8_t *data, size_t n, bsm_header_ext_vertranges_t *header) {
+  if (!bsm_read_header_v1(data, n, &header->header_v1)) return false;
+  if (header->header_v1.extension != BSM_EXT_VERTRANGES) return false;
+  if (n < sizeof(bsm_header_ext_vertranges_t)) return false;
+  
+  size_t offs = sizeof(bsm_header_v1_t);
+  reordercpy32((uint8_t*)header + offs, data + offs, sizeof(bsm_header_ext_vertranges_t) - offs);
+  
+  if (header->num_vertranges != header->header_v1.num_meshes) return false;
+  if (!chunk_fits(header->num_vertranges, sizeof(bsm_vertrange_t), header->offs_vertranges, n)) return false;
+  
+  chunk_span_t spans[BSM_NUM_CHUNKS + 1];
+  v1_spans(&header->header_v1, spans);
+  spans[BSM_NUM_CHUNKS] = (chunk_span_t){ header->offs_vertranges, bsm_vertranges_bytes(header) };
+  if (!spans_disjoint(spans, BSM_NUM_CHUNKS + 1, sizeof(bsm_header_ext_vertranges_t))) return false;
+  return true;
+}
+
+size_t bsm_vertranges_bytes(bsm_header_ext_vertranges_t *header) {
+  return header->num_vertranges * sizeof(bsm_vertrange_t);
+}
+
+bool bsm_read_vertranges(uint8_t *data, size_t n, bsm_header_ext_vertranges_t *header, bsm_vertrange_t *vertranges) {
+  size_t bytes = bsm_vertranges_bytes(header);
+  size_t offs  = header->offs_vertranges;
+  if (!in_bounds(offs, bytes, n)) return false;
+  
+  reordercpy32(vertranges, data + offs, bytes);
+  for (int32_t i = 0; i < header->num_vertranges; i++) {
+    bsm_vertrange_t *range = &vertranges[i];
+    if (range->idx_vert < 0 || range->num_vert < 0) return false;
+    if (range->num_vert > header->header_v1.num_verts - range->idx_vert) return false;
+  }
+  return true;
+}
+
+bool bsm_compute_vertranges(bsm_header_v1_t *header, bsm_triangle_t *tris, bsm_mesh_t *meshes, bsm_vertrange_t *vertranges) {
+  for (int32_t i = 0; i < header->num_meshes; i++) {
+    bsm_mesh_t *mesh = &meshes[i];
+    if (mesh->idx_tris < 0 || mesh->num_tris < 0) return false;
+    if (mesh->num_tris > header->num_tris - mesh->idx_tris) return false;
+    
+    int32_t lo = header->num_verts;
+    int32_t hi = -1;
+    for (int32_t j = mesh->idx_tris; j < mesh->idx_tris + mesh->num_tris; j++) {
+      for (int k = 0; k < 3; k++) {
+        int32_t index = tris[j].index[k];
+        if (index < 0 || index >= header->num_verts) return false;
+        if (index < lo) lo = index;
+        if (index > hi) hi = index;
+      }
+    }
+    vertranges[i].idx_vert = hi < lo ? 0 : lo;
+    vertranges[i].num_vert = hi < lo ? 0 : hi - lo + 1;
+  }
+  return true;
+}
+
+bool bsm_read_header_ext_hulls(uint8_t *data, size_t n, bsm_header_ext_hulls_t *header) {
+  if (!bsm_read_header_v1(data, n, &header->header_v1)) return false;
+  if (header->header_v1.extension != BSM_EXT_HULLS) return false;
+  if (n < sizeof(bsm_header_ext_hulls_t)) return false;
+  
+  size_t offs = sizeof(bsm_header_v1_t);
+  reordercpy32((uint8_t*)header + offs, data + offs, sizeof(bsm_header_ext_hulls_t) - offs);
+  
+  if (header->num_hulltopos != header->header_v1.num_hulls) return false;
+  if (!chunk_fits(header->num_hulltopos, sizeof(bsm_hulltopo_t), header->offs_hulltopos, n)) return false;
+  if (!chunk_fits(header->num_hullfaces, sizeof(bsm_hullface_t), header->offs_hullfaces, n)) return false;
+  if (!chunk_fits(header->num_hulledges, sizeof(bsm_hulledge_t), header->offs_hulledges, n)) return false;
+  
+  chunk_span_t spans[BSM_NUM_CHUNKS + 3];
+  v1_spans(&header->header_v1, spans);
+  spans[BSM_NUM_CHUNKS + 0] = (chunk_span_t){ header->offs_hulltopos, bsm_hulltopos_bytes(header) };
+  spans[BSM_NUM_CHUNKS + 1] = (chunk_span_t){ header->offs_hullfaces, bsm_hullfaces_bytes(header) };
+  spans[BSM_NUM_CHUNKS + 2] = (chunk_span_t){ header->offs_hulledges, bsm_hulledges_bytes(header) };
+  if (!spans_disjoint(spans, BSM_NUM_CHUNKS + 3, sizeof(bsm_header_ext_hulls_t))) return false;
+  return true;
+}
+
+size_t bsm_hulltopos_bytes(bsm_header_ext_hulls_t *header) {
+  return header->num_hulltopos * sizeof(bsm_hulltopo_t);
+}
+
+size_t bsm_hullfaces_bytes(bsm_header_ext_hulls_t *header) {
+  return header->num_hullfaces * sizeof(bsm_hullface_t);
+}
+
+size_t bsm_hulledges_bytes(bsm_header_ext_hulls_t *header) {
+  return header->num_hulledges * sizeof(bsm_hulledge_t);
+}
+
+bool bsm_read_hulltopos(uint8_t *data, size_t n, bsm_header_ext_hulls_t *header, bsm_hulltopo_t *hulltopos) {
+  size_t bytes = bsm_hulltopos_bytes(header);
+  size_t offs  = header->offs_hulltopos;
+  if (!in_bounds(offs, bytes, n)) return false;
+  
+  reordercpy32(hulltopos, data + offs, bytes);
+  for (int32_t i = 0; i < header->num_hulltopos; i++) {
+    bsm_hulltopo_t *topo = &hulltopos[i];
+    if (topo->idx_face < 0 || topo->num_face < 0 || topo->num_face > header->num_hullfaces - topo->idx_face) return false;
+    if (topo->idx_edge < 0 || topo->num_edge < 0 || topo->num_edge > header->num_hulledges - topo->idx_edge) return false;
+  }
+  return true;
+}
+
+bool bsm_read_hullfaces(uint8_t *data, size_t n, bsm_header_ext_hulls_t *header, bsm_hullface_t *hullfaces) {
+  size_t bytes = bsm_hullfaces_bytes(header);
+  size_t offs  = header->offs_hullfaces;
+  if (!in_bounds(offs, bytes, n)) return false;
+  
+  reordercpy32(hullfaces, data + offs, bytes);
+  for (int32_t i = 0; i < header->num_hullfaces; i++) {
+    bsm_hullface_t *face = &hullfaces[i];
+    if (face->idx_edge < 0 || face->num_edge < 3 || face->num_edge > header->num_hulledges - face->idx_edge) return false;
+  }
+  return true;
+}
+
+bool bsm_read_hulledges(uint8_t *data, size_t n, bsm_header_ext_hulls_t *header, bsm_hulledge_t *hulledges) {
+  size_t bytes = bsm_hulledges_bytes(header);
+  size_t offs  = header->offs_hulledges;
+  if (!in_bounds(offs, bytes, n)) return false;
+  
+  reordercpy32(hulledges, data + offs, bytes);
+  for (int32_t i = 0; i < header->num_hulledges; i++) {
+    bsm_hulledge_t *edge = &hulledges[i];
+    if (edge->vert < 0 || edge->vert >= header->header_v1.num_hullverts) return false;
+    if (edge->twin < 0 || edge->twin >= header->num_hulledges) return false;
+    if (edge->face < 0 || edge->face >= header->num_hullfaces) return false;
+  }
+  return true;
+}
+
+static int64_t *count_64(bsm_header_ext_64_t *header, bsm_chunk_t chunk) {
+  switch (chunk) {
+    case BSM_CHUNK_POSITIONS:
+    case BSM_CHUNK_TEXCOORDS:
+    case BSM_CHUNK_NORMALS:
+    case BSM_CHUNK_TANGENTS:  return &header->num_verts;
+    case BSM_CHUNK_TRIS:      return &header->num_tris;
+    case BSM_CHUNK_MESHES:    return &header->num_meshes;
+    case BSM_CHUNK_HULLVERTS: return &header->num_hullverts;
+    case BSM_CHUNK_HULLS:     return &header->num_hulls;
+    case BSM_CHUNK_VISVERTS:  return &header->num_visverts;
+    case BSM_CHUNK_VISTRIS:   return &header->num_vistris;
+    default:                  return NULL;
+  }
+}
+
+static int64_t *offs_64(bsm_header_ext_64_t *header, bsm_chunk_t chunk) {
+  switch (chunk) {
+    case BSM_CHUNK_POSITIONS: return &header->offs_positions;
+    case BSM_CHUNK_TEXCOORDS: return &header->offs_texcoords;
+    case BSM_CHUNK_NORMALS:   return &header->offs_normals;
+    case BSM_CHUNK_TANGENTS:  return &header->offs_tangents;
+    case BSM_CHUNK_TRIS:      return &header->offs_tris;
+    case BSM_CHUNK_MESHES:    return &header->offs_meshes;
+    case BSM_CHUNK_HULLVERTS: return &header->offs_hullverts;
+    case BSM_CHUNK_HULLS:     return &header->offs_hulls;
+    case BSM_CHUNK_VISVERTS:  return &header->offs_visverts;
+    case BSM_CHUNK_VISTRIS:   return &header->offs_vistris;
+    default:                  return NULL;
+  }
+}
+
+/* v1 count field shared by a chunk -- the four vertex attribute chunks share num_verts */
+static int32_t *count_v1(bsm_header_v1_t *header, bsm_chunk_t chunk) {
+  switch (chunk) {
+    case BSM_CHUNK_POSITIONS:
+    case BSM_CHUNK_TEXCOORDS:
+    case BSM_CHUNK_NORMALS:
+    case BSM_CHUNK_TANGENTS:  return &header->num_verts;
+    case BSM_CHUNK_TRIS:      return &header->num_tris;
+    case BSM_CHUNK_MESHES:    return &header->num_meshes;
+    case BSM_CHUNK_HULLVERTS: return &header->num_hullverts;
+    case BSM_CHUNK_HULLS:     return &header->num_hulls;
+    case BSM_CHUNK_VISVERTS:  return &header->num_visverts;
+    case BSM_CHUNK_VISTRIS:   return &header->num_vistris;
+    default:                  return NULL;
+  }
+}
+
+static int32_t *offs_v1(bsm_header_v1_t *header, bsm_chunk_t chunk) {
+  switch (chunk) {
+    case BSM_CHUNK_POSITIONS: return &header->offs_positions;
+    case BSM_CHUNK_TEXCOORDS: return &header->offs_texcoords;
+    case BSM_CHUNK_NORMALS:   return &header->offs_normals;
+    case BSM_CHUNK_TANGENTS:  return &header->offs_tangents;
+    case BSM_CHUNK_TRIS:      return &header->offs_tris;
+    case BSM_CHUNK_MESHES:    return &header->offs_meshes;
+    case BSM_CHUNK_HULLVERTS: return &header->offs_hullverts;
+    case BSM_CHUNK_HULLS:     return &header->offs_hulls;
+    case BSM_CHUNK_VISVERTS:  return &header->offs_visverts;
+    case BSM_CHUNK_VISTRIS:   return &header->offs_vistris;
+    default:                  return NULL;
+  }
+}
+
+bool bsm_chunk_fits(bsm_header_v1_t *header, bsm_chunk_t chunk, size_t n) {
+  int32_t *count = count_v1(header, chunk);
+  int32_t *offs  = offs_v1(header, chunk);
+  return count != NULL && chunk_fits(*count, bsm_chunk_sizes[chunk], *offs, n);
+}
+
+bool bsm_read_header_ext_64(uint8_t *data, size_t n, bsm_header_ext_64_t *header) {
+  if (!bsm_read_header_v1(data, n, &header->header_v1)) return false;
+  if (header->header_v1.extension != BSM_EXT_64) return false;
+  if (n < sizeof(bsm_header_ext_64_t)) return false;
+  
+  size_t offs = sizeof(bsm_header_v1_t);
+  size_t wide = offsetof(bsm_header_ext_64_t, num_verts);
+  reordercpy32((uint8_t*)header + offs, data + offs, wide - offs);
+  reordercpy64((uint8_t*)header + wide, data + wide, sizeof(bsm_header_ext_64_t) - wide);
+  
+  bool empty_v1  = true;
+  bool mirror_v1 = true;
+  chunk_span_t spans[BSM_NUM_CHUNKS];
+  for (int c = 0; c < BSM_NUM_CHUNKS; c++) {
+    int64_t count = *count_64(header, c);
+    int64_t start = *offs_64(header, c);
+    if (count < 0 || count > INT32_MAX) return false;
+    if (!chunk_fits(count, bsm_chunk_sizes[c], start, n)) return false;
+    
+    int32_t count_32 = *count_v1(&header->header_v1, c);
+    int32_t offs_32  = *offs_v1(&header->header_v1, c);
+    if (count_32 != 0 || offs_32 != 0) empty_v1 = false;
+    if (count_32 != count || offs_32 != start) mirror_v1 = false;
+    
+    spans[c].offs  = start;
+    spans[c].bytes = bsm_chunk_bytes_64(header, c);
+  }
+  /* a v1 view that disagrees with the 64-bit one would make the file decode differently depending on the reader */
+  if (!empty_v1 && !mirror_v1) return false;
+  if (!spans_disjoint(spans, BSM_NUM_CHUNKS, sizeof(bsm_header_ext_64_t))) return false;
+  return true;
+}
+
+bool bsm_read_header_64(uint8_t *data, size_t n, bsm_header_ext_64_t *header) {
+  if (!bsm_read_header_v1(data, n, &header->header_v1)) return false;
+  if (header->header_v1.extension == BSM_EXT_64) return bsm_read_header_ext_64(data, n, header);
+  
+  header->reserved = 0;
+  for (int c = 0; c < BSM_NUM_CHUNKS; c++) {
+    *count_64(header, c) = *count_v1(&header->header_v1, c);
+    *offs_64(header, c)  = *offs_v1(&header->header_v1, c);
+  }
+  return true;
+}
+
+uint64_t bsm_chunk_offs_64(bsm_header_ext_64_t *header, bsm_chunk_t chunk) {
+  if (chunk < 0 || chunk >= BSM_NUM_CHUNKS) return 0;
+  return *offs_64(header, chunk);
+}
+
+uint64_t bsm_chunk_bytes_64(bsm_header_ext_64_t *header, bsm_chunk_t chunk) {
+  if (chunk < 0 || chunk >= BSM_NUM_CHUNKS) return 0;
+  return (uint64_t)*count_64(header, chunk) * bsm_chunk_sizes[chunk];
+}
+
+bool bsm_read_chunk_64(uint8_t *data, size_t n, bsm_header_ext_64_t *header, bsm_chunk_t chunk, void *out) {
+  if (chunk < 0 || chunk >= BSM_NUM_CHUNKS) return false;
+  
+  uint64_t bytes = bsm_chunk_bytes_64(header, chunk);
+  uint64_t offs  = bsm_chunk_offs_64(header, chunk);
+  if (!in_bounds(offs, bytes, n)) return false;
+  
+  reordercpy32(out, data + offs, bytes);
+  if (chunk == BSM_CHUNK_NORMALS) {
+    bsm_normal_t *normals = out;
+    for (int64_t i = 0; i < header->num_verts; i++) normalize_normal(&normals[i]);
+  } else if (chunk == BSM_CHUNK_TANGENTS) {
+    bsm_tangent_t *tangents = out;
+    for (int64_t i = 0; i < header->num_verts; i++) normalize_tangent(&tangents[i]);
+  }
+  return true;
+}
+
+bool bsm_read_header_ext_tiles(uint8_t *data, size_t n, bsm_header_ext_tiles_t *header) {
+  if (!bsm_read_header_v1(data, n, &header->header_v1)) return false;
+  if (header->header_v1.extension != BSM_EXT_TILES) return false;
+  if (n < sizeof(bsm_header_ext_tiles_t)) return false;
+  
+  size_t offs = sizeof(bsm_header_v1_t);
+  reordercpy32((uint8_t*)header + offs, data + offs, sizeof(bsm_header_ext_tiles_t) - offs);
+  
+  if (!chunk_fits(header->num_tiles, sizeof(bsm_tile_t), header->offs_tiles, n)) return false;
+  
+  chunk_span_t spans[BSM_NUM_CHUNKS + 1];
+  v1_spans(&header->header_v1, spans);
+  spans[BSM_NUM_CHUNKS] = (chunk_span_t){ header->offs_tiles, bsm_tiles_bytes(header) };
+  if (!spans_disjoint(spans, BSM_NUM_CHUNKS + 1, sizeof(bsm_header_ext_tiles_t))) return false;
+  return true;
+}
+
+size_t bsm_tiles_bytes(bsm_header_ext_tiles_t *header) {
+  return header->num_tiles * sizeof(bsm_tile_t);
+}
+
+static bool tile_valid(bsm_header_v1_t *header, bsm_tile_t *tile) {
+  if (tile->idx_mesh < 0 || tile->num_mesh < 0 || tile->num_mesh > header->num_meshes - tile->idx_mesh) return false;
+  if (tile->idx_tris < 0 || tile->num_tris < 0 || tile->num_tris > header->num_tris - tile->idx_tris) return false;
+  if (tile->idx_vert < 0 || tile->num_vert < 0 || tile->num_vert > header->num_verts - tile->idx_vert) return false;
+  return true;
+}
+
+bool bsm_read_tiles(uint8_t *data, size_t n, bsm_header_ext_tiles_t *header, bsm_tile_t *tiles) {
+  size_t bytes = bsm_tiles_bytes(header);
+  size_t offs  = header->offs_tiles;
+  if (!in_bounds(offs, bytes, n)) return false;
+  
+  reordercpy32(tiles, data + offs, bytes);
+  for (int32_t i = 0; i < header->num_tiles; i++) {
+    if (!tile_valid(&header->header_v1, &tiles[i])) return false;
+  }
+  return true;
+}
+
+int32_t bsm_query_tiles_bbox(bsm_header_ext_tiles_t *header, bsm_tile_t *tiles, bsm_bbox_t *bbox, int32_t *select) {
+  int32_t num_select = 0;
+  for (int32_t i = 0; i < header->num_tiles; i++) {
+    bsm_bbox_t *b = &tiles[i].bbox;
+    if (b->x0 > bbox->x1 || b->x1 < bbox->x0) continue;
+    if (b->y0 > bbox->y1 || b->y1 < bbox->y0) continue;
+    if (b->z0 > bbox->z1 || b->z1 < bbox->z0) continue;
+    select[num_select++] = i;
+  }
+  return num_select;
+}
+
+int32_t bsm_query_tiles_sphere(bsm_header_ext_tiles_t *header, bsm_tile_t *tiles, bsm_bsphere_t *sphere, int32_t *select) {
+  int32_t num_select = 0;
+  for (int32_t i = 0; i < header->num_tiles; i++) {
+    /* distance from the center to the nearest point of the box */
+    bsm_bbox_t *b = &tiles[i].bbox;
+    float32_t dx = fmaxf(fmaxf(b->x0 - sphere->x, sphere->x - b->x1), 0.0f);
+    float32_t dy = fmaxf(fmaxf(b->y0 - sphere->y, sphere->y - b->y1), 0.0f);
+    float32_t dz = fmaxf(fmaxf(b->z0 - sphere->z, sphere->z - b->z1), 0.0f);
+    if (dx * dx + dy * dy + dz * dz > sphere->radius * sphere->radius) continue;
+    select[num_select++] = i;
+  }
+  return num_select;
+}
+
+/* decodes count consecutive elements of a chunk starting at element idx */
+static bool read_range32(void *dst, uint8_t *data, size_t n, size_t offs, size_t stride, int32_t idx, int32_t count) {
+  size_t bytes = (size_t)count * stride;
+  size_t src   = offs + (size_t)idx * stride;
+  if (!in_bounds(src, bytes, n)) return false;
+  
+  reordercpy32(dst, data + src, bytes);
+  return true;
+}
+
+bool bsm_read_tile(uint8_t *data, size_t n, bsm_header_ext_tiles_t *header, bsm_tile_t *tile, bsm_position_t *positions, bsm_texcoord_t *texcoords, bsm_normal_t *normals, bsm_tangent_t *tangents, bsm_triangle_t *tris, bsm_mesh_t *meshes) {
+  bsm_header_v1_t *v1 = &header->header_v1;
+  if (!tile_valid(v1, tile)) return false;
+  
+  int32_t idx = tile->idx_vert;
+  int32_t num = tile->num_vert;
+  if (positions != NULL && !read_range32(positions, data, n, v1->offs_positions, sizeof(bsm_position_t), idx, num)) return false;
+  if (texcoords != NULL && !read_range32(texcoords, data, n, v1->offs_texcoords, sizeof(bsm_texcoord_t), idx, num)) return false;
+  if (normals != NULL) {
+    if (!read_range32(normals, data, n, v1->offs_normals, sizeof(bsm_normal_t), idx, num)) return false;
+    for (int32_t i = 0; i < num; i++) normalize_normal(&normals[i]);
+  }
+  if (tangents != NULL) {
+    if (!read_range32(tangents, data, n, v1->offs_tangents, sizeof(bsm_tangent_t), idx, num)) return false;
+    for (int32_t i = 0; i < num; i++) normalize_tangent(&tangents[i]);
+  }
+  if (tris != NULL) {
+    if (!read_range32(tris, data, n, v1->offs_tris, sizeof(bsm_triangle_t), tile->idx_tris, tile->num_tris)) return false;
+    for (int32_t i = 0; i < tile->num_tris; i++) {
+      for (int k = 0; k < 3; k++) {
+        int32_t index = tris[i].index[k];
+        if (index < idx || index - idx >= num) return false;
+        tris[i].index[k] = index - idx;
+      }
+    }
+  }
+  if (meshes != NULL) {
+    if (!read_range32(meshes, data, n, v1->offs_meshes, sizeof(bsm_mesh_t), tile->idx_mesh, tile->num_mesh)) return false;
+    for (int32_t i = 0; i < tile->num_mesh; i++) {
+      bsm_mesh_t *mesh = &meshes[i];
+      if (mesh->idx_tris < tile->idx_tris) return false;
+      mesh->idx_tris -= tile->idx_tris;
+      if (mesh->num_tris < 0 || mesh->num_tris > tile->num_tris - mesh->idx_tris) return false;
+    }
+  }
+  return true;
+}
+
+int32_t bsm_submesh_tris(bsm_header_v1_t *header, bsm_mesh_t *meshes, int32_t *select, int32_t num_select) {
+  int32_t total = 0;
+  for (int32_t i = 0; i < num_select; i++) {
+    if (select[i] < 0 || select[i] >= header->num_meshes) return -1;
+    bsm_mesh_t *mesh = &meshes[select[i]];
+    if (mesh->idx_tris < 0 || mesh->num_tris < 0) return -1;
+    if (mesh->num_tris > header->num_tris - mesh->idx_tris) return -1;
+    if (mesh->num_tris > INT32_MAX - total) return -1;
+    total += mesh->num_tris;
+  }
+  return total;
+}
+
+bool bsm_read_submesh_tris(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_mesh_t *meshes, int32_t *select, int32_t num_select, bsm_triangle_t *tris, bsm_mesh_t *submeshes) {
+  if (bsm_submesh_tris(header, meshes, select, num_select) < 0) return false;
+  
+  int32_t idx_tris = 0;
+  for (int32_t i = 0; i < num_select; i++) {
+    bsm_mesh_t *mesh = &meshes[select[i]];
+    size_t bytes = mesh->num_tris * sizeof(bsm_triangle_t);
+    size_t offs  = header->offs_tris + (size_t)mesh->idx_tris * sizeof(bsm_triangle_t);
+    if (!in_bounds(offs, bytes, n)) return false;
+    
+    reordercpy32(&tris[idx_tris], data + offs, bytes);
+    if (submeshes != NULL) {
+      submeshes[i] = *mesh;
+      submeshes[i].idx_tris = idx_tris;
+    }
+    idx_tris += mesh->num_tris;
+  }
+  return true;
+}
+
+size_t bsm_submesh_remap_bytes(bsm_header_v1_t *header) {
+  return header->num_verts * sizeof(int32_t);
+}
+
+/* numbers the marked entries of remap[lo, hi] in ascending order, then rewrites the triangles to local indices */
+static int32_t submesh_compact(int32_t lo, int32_t hi, bsm_triangle_t *tris, int32_t num_tris, int32_t *remap, int32_t *verts) {
+  int32_t num_verts = 0;
+  for (int32_t i = lo; i <= hi; i++) {
+    if (remap[i] < 0) continue;
+    remap[i] = num_verts;
+    verts[num_verts++] = i;
+  }
+  for (int32_t i = 0; i < num_tris; i++) {
+    for (int k = 0; k < 3; k++) {
+      int32_t index = tris[i].index[k];
+      if (index < lo || index > hi || remap[index] < 0) return -1;
+      tris[i].index[k] = remap[index];
+    }
+  }
+  return num_verts;
+}
+
+int32_t bsm_submesh_remap(bsm_header_v1_t *header, bsm_triangle_t *tris, int32_t num_tris, int32_t *remap, int32_t *verts) {
+  int32_t lo = header->num_verts;
+  int32_t hi = -1;
+  for (int32_t i = 0; i < num_tris; i++) {
+    for (int k = 0; k < 3; k++) {
+      int32_t index = tris[i].index[k];
+      if (index < 0 || index >= header->num_verts) return -1;
+      if (index < lo) lo = index;
+      if (index > hi) hi = index;
+    }
+  }
+  
+  for (int32_t i = lo; i <= hi; i++) remap[i] = -1;
+  for (int32_t i = 0; i < num_tris; i++) {
+    remap[tris[i].index[0]] = 0;
+    remap[tris[i].index[1]] = 0;
+    remap[tris[i].index[2]] = 0;
+  }
+  return submesh_compact(lo, hi, tris, num_tris, remap, verts);
+}
+
+int32_t bsm_submesh_remap_ranged(bsm_header_v1_t *header, bsm_vertrange_t *vertranges, int32_t *select, int32_t num_select, bsm_triangle_t *tris, int32_t num_tris, int32_t *remap, int32_t *verts) {
+  int32_t lo = header->num_verts;
+  int32_t hi = -1;
+  for (int32_t i = 0; i < num_select; i++) {
+    if (select[i] < 0 || select[i] >= header->num_meshes) return -1;
+    bsm_vertrange_t *range = &vertranges[select[i]];
+    if (range->idx_vert < 0 || range->num_vert < 0) return -1;
+    if (range->num_vert > header->num_verts - range->idx_vert) return -1;
+    if (range->num_vert == 0) continue;
+    if (range->idx_vert < lo) lo = range->idx_vert;
+    if (range->idx_vert + range->num_vert - 1 > hi) hi = range->idx_vert + range->num_vert - 1;
+  }
+  
+  for (int32_t i = lo; i <= hi; i++) remap[i] = -1;
+  for (int32_t i = 0; i < num_select; i++) {
+    bsm_vertrange_t *range = &vertranges[select[i]];
+    for (int32_t j = range->idx_vert; j < range->idx_vert + range->num_vert; j++) remap[j] = 0;
+  }
+  return submesh_compact(lo, hi, tris, num_tris, remap, verts);
+}
+
+/* decodes the listed vertices of one attribute chunk, copying runs of consecutive indices in one go */
+static bool gather32(void *dst, uint8_t *data, size_t n, bsm_header_v1_t *header, size_t offs, size_t stride, int32_t *verts, int32_t num_verts) {
+  uint8_t *out = dst;
+  int32_t i = 0;
+  while (i < num_verts) {
+    if (verts[i] < 0 || verts[i] >= header->num_verts) return false;
+    int32_t j = i + 1;
+    while (j < num_verts && verts[j] == verts[j-1] + 1 && verts[j] < header->num_verts) j++;
+    
+    size_t bytes = (size_t)(j - i) * stride;
+    size_t src   = offs + (size_t)verts[i] * stride;
+    if (!in_bounds(src, bytes, n)) return false;
+    
+    reordercpy32(out + (size_t)i * stride, data + src, bytes);
+    i = j;
+  }
+  return true;
+}
+
+bool bsm_gather_positions(uint8_t *data, size_t n, bsm_header_v1_t *header, int32_t *verts, int32_t num_verts, bsm_position_t *positions) {
+  return gather32(positions, data, n, header, header->offs_positions, sizeof(bsm_position_t), verts, num_verts);
+}
+
+bool bsm_gather_texcoords(uint8_t *data, size_t n, bsm_header_v1_t *header, int32_t *verts, int32_t num_verts, bsm_texcoord_t *texcoords) {
+  return gather32(texcoords, data, n, header, header->offs_texcoords, sizeof(bsm_texcoord_t), verts, num_verts);
+}
+
+bool bsm_gather_normals(uint8_t *data, size_t n, bsm_header_v1_t *header, int32_t *verts, int32_t num_verts, bsm_normal_t *normals) {
+  if (!gather32(normals, data, n, header, header->offs_normals, sizeof(bsm_normal_t), verts, num_verts)) return false;
+  for (int32_t i = 0; i < num_verts; i++) {
+    normalize_normal(&normals[i]);
+  }
+  return true;
+}
+
+bool bsm_gather_tangents(uint8_t *data, size_t n, bsm_header_v1_t *header, int32_t *verts, int32_t num_verts, bsm_tangent_t *tangents) {
+  if (!gather32(tangents, data, n, header, header->offs_tangents, sizeof(bsm_tangent_t), verts, num_verts)) return false;
+  for (int32_t i = 0; i < num_verts; i++) {
+    normalize_tangent(&tangents[i]);
+  }
+  return true;
+}
+
+void bsm_init_header_v1(bsm_header_v1_t *header, int32_t extension) {
+  memset(header, 0, sizeof(bsm_header_v1_t));
+  memcpy(header->magic, bsm_magic, sizeof(bsm_magic));
+  header->version   = 1;
+  header->extension = extension;
+}
+
+/* places a chunk at offs and moves offs past it -- false once the chunk can no longer be reached by a 32-bit offset */
+static bool layout32(int32_t *field, uint64_t *offs, int64_t count, size_t size) {
+  if (count < 0 || *offs > INT32_MAX) return false;
+  *field = (int32_t)*offs;
+  *offs += (uint64_t)count * size;
+  return true;
+}
+
+/* the whole file has to stay within reach of the 32-bit offsets, otherwise the layout fails with 0 */
+static size_t layout32_end(uint64_t offs) {
+  return offs <= INT32_MAX ? (size_t)offs : 0;
+}
+
+size_t bsm_layout_v1(bsm_header_v1_t *header, size_t offs) {
+  uint64_t end = offs;
+  for (int c = 0; c < BSM_NUM_CHUNKS; c++) {
+    if (!layout32(offs_v1(header, c), &end, *count_v1(header, c), bsm_chunk_sizes[c])) return 0;
+  }
+  return layout32_end(end);
+}
+
+size_t bsm_layout_model(bsm_model_t *model) {
+  return bsm_layout_v1(&model->header, sizeof(bsm_header_v1_t));
+}
+
+size_t bsm_layout_ext_vertranges(bsm_header_ext_vertranges_t *header) {
+  uint64_t offs = bsm_layout_v1(&header->header_v1, sizeof(bsm_header_ext_vertranges_t));
+  header->num_vertranges = header->header_v1.num_meshes;
+  if (offs == 0) return 0;
+  if (!layout32(&header->offs_vertranges, &offs, header->num_vertranges, sizeof(bsm_vertrange_t))) return 0;
+  return layout32_end(offs);
+}
+
+size_t bsm_layout_ext_hulls(bsm_header_ext_hulls_t *header) {
+  uint64_t offs = bsm_layout_v1(&header->header_v1, sizeof(bsm_header_ext_hulls_t));
+  header->num_hulltopos = header->header_v1.num_hulls;
+  if (offs == 0) return 0;
+  if (!layout32(&header->offs_hulltopos, &offs, header->num_hulltopos, sizeof(bsm_hulltopo_t))) return 0;
+  if (!layout32(&header->offs_hullfaces, &offs, header->num_hullfaces, sizeof(bsm_hullface_t))) return 0;
+  if (!layout32(&header->offs_hulledges, &offs, header->num_hulledges, sizeof(bsm_hulledge_t))) return 0;
+  return layout32_end(offs);
+}
+
+uint64_t bsm_layout_ext_64(bsm_header_ext_64_t *header) {
+  uint64_t offs = sizeof(bsm_header_ext_64_t);
+  for (int c = 0; c < BSM_NUM_CHUNKS; c++) {
+    int64_t count = *count_64(header, c);
+    if (count < 0 || count > INT32_MAX) return 0;
+    *offs_64(header, c) = offs; offs += bsm_chunk_bytes_64(header, c);
+  }
+  
+  bool fits = offs <= INT32_MAX;
+  for (int c = 0; c < BSM_NUM_CHUNKS; c++) {
+    *count_v1(&header->header_v1, c) = fits ? *count_64(header, c) : 0;
+    *offs_v1(&header->header_v1, c)  = fits ? *offs_64(header, c) : 0;
+  }
+  return offs;
+}
+
+size_t bsm_layout_ext_tiles(bsm_header_ext_tiles_t *header) {
+  uint64_t offs = bsm_layout_v1(&header->header_v1, sizeof(bsm_header_ext_tiles_t));
+  if (offs == 0) return 0;
+  if (!layout32(&header->offs_tiles, &offs, header->num_tiles, sizeof(bsm_tile_t))) return 0;
+  return layout32_end(offs);
+}
+
+static bool write32(uint8_t *data, size_t n, uint64_t offs, const void *src, uint64_t bytes) {
+  if (!in_bounds(offs, bytes, n)) return false;
+  
+  reordercpy32(data + offs, src, bytes);
+  return true;
+}
+
+bool bsm_write_header_v1(uint8_t *data, size_t n, bsm_header_v1_t *header) {
+  return write32(data, n, 0, header, sizeof(bsm_header_v1_t));
+}
+
+bool bsm_write_model(uint8_t *data, size_t n, bsm_model_t *model) {
+  bsm_header_v1_t *header = &model->header;
+  return bsm_write_header_v1(data, n, header) &&
+    bsm_write_positions(data, n, header, model->positions) &&
+    bsm_write_texcoords(data, n, header, model->texcoords) &&
+    bsm_write_normals(data, n, header, model->normals) &&
+    bsm_write_tangents(data, n, header, model->tangents) &&
+    bsm_write_tris(data, n, header, model->tris) &&
+    bsm_write_meshes(data, n, header, model->meshes) &&
+    bsm_write_hullverts(data, n, header, model->hullverts) &&
+    bsm_write_hulls(data, n, header, model->hulls) &&
+    bsm_write_visverts(data, n, header, model->visverts) &&
+    bsm_write_vistris(data, n, header, model->vistris);
+}
+
+bool bsm_write_positions(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_position_t *positions) {
+  return write32(data, n, header->offs_positions, positions, bsm_positions_bytes(header));
+}
+
+bool bsm_write_texcoords(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_texcoord_t *texcoords) {
+  return write32(data, n, header->offs_texcoords, texcoords, bsm_texcoords_bytes(header));
+}
+
+bool bsm_write_normals(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_normal_t *normals) {
+  return write32(data, n, header->offs_normals, normals, bsm_normals_bytes(header));
+}
+
+bool bsm_write_tangents(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_tangent_t *tangents) {
+  return write32(data, n, header->offs_tangents, tangents, bsm_tangents_bytes(header));
+}
+
+bool bsm_write_tris(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_triangle_t *tris) {
+  return write32(data, n, header->offs_tris, tris, bsm_tris_bytes(header));
+}
+
+bool bsm_write_meshes(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_mesh_t *meshes) {
+  return write32(data, n, header->offs_meshes, meshes, bsm_meshes_bytes(header));
+}
+
+bool bsm_write_hullverts(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_hullvert_t *hullverts) {
+  return write32(data, n, header->offs_hullverts, hullverts, bsm_hullverts_bytes(header));
+}
+
+bool bsm_write_hulls(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_hull_t *hulls) {
+  return write32(data, n, header->offs_hulls, hulls, bsm_hulls_bytes(header));
+}
+
+bool bsm_write_visverts(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_visvert_t *visverts) {
+  return write32(data, n, header->offs_visverts, visverts, bsm_visverts_bytes(header));
+}
+
+bool bsm_write_vistris(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_vistri_t *vistris) {
+  return write32(data, n, header->offs_vistris, vistris, bsm_vistris_bytes(header));
+}
+
+bool bsm_write_header_ext_vertranges(uint8_t *data, size_t n, bsm_header_ext_vertranges_t *header) {
+  return write32(data, n, 0, header, sizeof(bsm_header_ext_vertranges_t));
+}
+
+bool bsm_write_vertranges(uint8_t *data, size_t n, bsm_header_ext_vertranges_t *header, bsm_vertrange_t *vertranges) {
+  return write32(data, n, header->offs_vertranges, vertranges, bsm_vertranges_bytes(header));
+}
+
+bool bsm_write_header_ext_hulls(uint8_t *data, size_t n, bsm_header_ext_hulls_t *header) {
+  return write32(data, n, 0, header, sizeof(bsm_header_ext_hulls_t));
+}
+
+bool bsm_write_hulltopos(uint8_t *data, size_t n, bsm_header_ext_hulls_t *header, bsm_hulltopo_t *hulltopos) {
+  return write32(data, n, header->offs_hulltopos, hulltopos, bsm_hulltopos_bytes(header));
+}
+
+bool bsm_write_hullfaces(uint8_t *data, size_t n, bsm_header_ext_hulls_t *header, bsm_hullface_t *hullfaces) {
+  return write32(data, n, header->offs_hullfaces, hullfaces, bsm_hullfaces_bytes(header));
+}
+
+bool bsm_write_hulledges(uint8_t *data, size_t n, bsm_header_ext_hulls_t *header, bsm_hulledge_t *hulledges) {
+  return write32(data, n, header->offs_hulledges, hulledges, bsm_hulledges_bytes(header));
+}
+
+bool bsm_write_header_ext_64(uint8_t *data, size_t n, bsm_header_ext_64_t *header) {
+  size_t wide = offsetof(bsm_header_ext_64_t, num_verts);
+  if (n < sizeof(bsm_header_ext_64_t)) return false;
+  
+  reordercpy32(data, header, wide);
+  reordercpy64(data + wide, (uint8_t*)header + wide, sizeof(bsm_header_ext_64_t) - wide);
+  return true;
+}
+
+bool bsm_write_chunk_64(uint8_t *data, size_t n, bsm_header_ext_64_t *header, bsm_chunk_t chunk, const void *src) {
+  if (chunk < 0 || chunk >= BSM_NUM_CHUNKS) return false;
+  return write32(data, n, bsm_chunk_offs_64(header, chunk), src, bsm_chunk_bytes_64(header, chunk));
+}
+
+bool bsm_write_header_ext_tiles(uint8_t *data, size_t n, bsm_header_ext_tiles_t *header) {
+  return write32(data, n, 0, header, sizeof(bsm_header_ext_tiles_t));
+}
+
+bool bsm_write_tiles(uint8_t *data, size_t n, bsm_header_ext_tiles_t *header, bsm_tile_t *tiles) {
+  return write32(data, n, header->offs_tiles, tiles, bsm_tiles_bytes(header));
+}
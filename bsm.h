@@ -5,6 +5,10 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 typedef float float32_t;
 
 typedef struct bsm_bbox {
@@ -95,9 +99,142 @@ typedef struct bsm_vistri {
   int32_t index[3];
 } bsm_vistri_t;
 
+/* per-mesh vertex range extension -- one range per mesh, covering every vertex referenced by that mesh's triangles */
+#define BSM_EXT_VERTRANGES 0x474E5256 /* "VRNG" */
+
+typedef struct bsm_vertrange {
+  int32_t idx_vert;
+  int32_t num_vert;
+} bsm_vertrange_t;
+
+typedef struct bsm_header_ext_vertranges {
+  bsm_header_v1_t header_v1;
+  int32_t num_vertranges;
+  int32_t offs_vertranges;
+} bsm_header_ext_vertranges_t;
+
+/* collision hull topology extension -- per-hull face planes and a half-edge graph over the (cleaned) hull vertices.  a
+ * degenerate (flat) hull has no faces or edges */
+#define BSM_EXT_HULLS 0x4C4C5548 /* "HULL" */
+
+typedef struct bsm_hulltopo {
+  int32_t idx_face;
+  int32_t num_face;
+  int32_t idx_edge;
+  int32_t num_edge;
+} bsm_hulltopo_t;
+
+/* outward plane x*px + y*py + z*pz = d, bounded by num_edge half-edges in counter-clockwise order */
+typedef struct bsm_hullface {
+  float32_t x, y, z, d;
+  int32_t idx_edge;
+  int32_t num_edge;
+} bsm_hullface_t;
+
+/* half-edge leaving hull vertex 'vert' -- 'twin' is the opposite half-edge, whose face is the neighbour across this edge */
+typedef struct bsm_hulledge {
+  int32_t vert;
+  int32_t twin;
+  int32_t face;
+} bsm_hulledge_t;
+
+typedef struct bsm_header_ext_hulls {
+  bsm_header_v1_t header_v1;
+  int32_t num_hulltopos;
+  int32_t offs_hulltopos;
+  int32_t num_hullfaces;
+  int32_t offs_hullfaces;
+  int32_t num_hulledges;
+  int32_t offs_hulledges;
+} bsm_header_ext_hulls_t;
+
+/* 64-bit offset extension for models whose chunks lie beyond the 2 GB reach of the v1 offsets.  the v1 fields mirror
+ * the 64-bit ones when the whole file fits in 32 bits and are otherwise all zero, so plain v1 readers see an empty
+ * model rather than a truncated one.  counts are still limited to INT32_MAX since triangles, meshes and hulls index
+ * with 32-bit fields -- at that limit the position chunk alone is 24 GB */
+#define BSM_EXT_64 0x34365342 /* "BS64" */
+
+typedef struct bsm_header_ext_64 {
+  bsm_header_v1_t header_v1;
+  int32_t reserved;
+  int64_t num_verts;
+  int64_t offs_positions;
+  int64_t offs_texcoords;
+  int64_t offs_normals;
+  int64_t offs_tangents;
+  int64_t num_tris;
+  int64_t offs_tris;
+  int64_t num_meshes;
+  int64_t offs_meshes;
+  int64_t num_hullverts;
+  int64_t offs_hullverts;
+  int64_t num_hulls;
+  int64_t offs_hulls;
+  int64_t num_visverts;
+  int64_t offs_visverts;
+  int64_t num_vistris;
+  int64_t offs_vistris;
+} bsm_header_ext_64_t;
+
+/* spatial tiling extension -- the render geometry is partitioned into spatially coherent tiles, each owning contiguous
+ * runs of meshes, triangles and vertices (vertices on tile borders are duplicated) so that it decodes on its own */
+#define BSM_EXT_TILES 0x454C4954 /* "TILE" */
+
+typedef struct bsm_tile {
+  bsm_bbox_t bbox;
+  int32_t idx_mesh;
+  int32_t num_mesh;
+  int32_t idx_tris;
+  int32_t num_tris;
+  int32_t idx_vert;
+  int32_t num_vert;
+} bsm_tile_t;
+
+typedef struct bsm_header_ext_tiles {
+  bsm_header_v1_t header_v1;
+  int32_t num_tiles;
+  int32_t offs_tiles;
+} bsm_header_ext_tiles_t;
+
+/* the v1 chunks, in file layout order */
+typedef enum bsm_chunk {
+  BSM_CHUNK_POSITIONS,
+  BSM_CHUNK_TEXCOORDS,
+  BSM_CHUNK_NORMALS,
+  BSM_CHUNK_TANGENTS,
+  BSM_CHUNK_TRIS,
+  BSM_CHUNK_MESHES,
+  BSM_CHUNK_HULLVERTS,
+  BSM_CHUNK_HULLS,
+  BSM_CHUNK_VISVERTS,
+  BSM_CHUNK_VISTRIS,
+  BSM_NUM_CHUNKS
+} bsm_chunk_t;
+
+/* a fully decoded v1 model -- chunks are allocated by bsm_read_model() and released with bsm_free_model() */
+typedef struct bsm_model {
+  bsm_header_v1_t header;
+  bsm_position_t *positions;
+  bsm_texcoord_t *texcoords;
+  bsm_normal_t   *normals;
+  bsm_tangent_t  *tangents;
+  bsm_triangle_t *tris;
+  bsm_mesh_t     *meshes;
+  bsm_hullvert_t *hullverts;
+  bsm_hull_t     *hulls;
+  bsm_visvert_t  *visverts;
+  bsm_vistri_t   *vistris;
+} bsm_model_t;
+
 /* reads a header from a raw data buffer -- returns true if file is a valid BSM-format model, false if not */
 bool bsm_read_header_v1(uint8_t *data, size_t n, bsm_header_v1_t *header);
 
+/* location of a chunk within a file described by header */
+size_t bsm_chunk_offs(bsm_header_v1_t *header, bsm_chunk_t chunk);
+size_t bsm_chunk_bytes(bsm_header_v1_t *header, bsm_chunk_t chunk);
+/* overflow-proof check that a chunk lies within n bytes, for headers that bsm_read_header_v1() has not validated */
+bool bsm_chunk_fits(bsm_header_v1_t *header, bsm_chunk_t chunk, size_t n);
+
 size_t bsm_positions_bytes(bsm_header_v1_t *header);
 size_t bsm_texcoords_bytes(bsm_header_v1_t *header);
 size_t bsm_normals_bytes(bsm_header_v1_t *header);
@@ -122,4 +259,118 @@ bool bsm_read_hulls(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_hull_t
 bool bsm_read_visverts(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_visvert_t *visverts);
 bool bsm_read_vistris(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_vistri_t *vistris);
 
+/* decodes every v1 chunk of a model -- returns false (with nothing left allocated) if the file is invalid or memory runs out */
+bool bsm_read_model(uint8_t *data, size_t n, bsm_model_t *model);
+/* allocates zero-filled chunks for the counts already set in model->header */
+bool bsm_alloc_model(bsm_model_t *model);
+void bsm_free_model(bsm_model_t *model);
+
+/* reads a vertex range extension header -- returns false if the file is not a valid BSM model or does not carry the extension */
+bool bsm_read_header_ext_vertranges(uint8_t *data, size_t n, bsm_header_ext_vertranges_t *header);
+
+size_t bsm_vertranges_bytes(bsm_header_ext_vertranges_t *header);
+bool bsm_read_vertranges(uint8_t *data, size_t n, bsm_header_ext_vertranges_t *header, bsm_vertrange_t *vertranges);
+
+/* computes one vertex range per mesh from decoded triangles and meshes -- returns false if a mesh or index is out of bounds */
+bool bsm_compute_vertranges(bsm_header_v1_t *header, bsm_triangle_t *tris, bsm_mesh_t *meshes, bsm_vertrange_t *vertranges);
+
+/* reads a hull topology extension header -- returns false if the file is not a valid BSM model or does not carry the extension */
+bool bsm_read_header_ext_hulls(uint8_t *data, size_t n, bsm_header_ext_hulls_t *header);
+
+size_t bsm_hulltopos_bytes(bsm_header_ext_hulls_t *header);
+size_t bsm_hullfaces_bytes(bsm_header_ext_hulls_t *header);
+size_t bsm_hulledges_bytes(bsm_header_ext_hulls_t *header);
+bool bsm_read_hulltopos(uint8_t *data, size_t n, bsm_header_ext_hulls_t *header, bsm_hulltopo_t *hulltopos);
+bool bsm_read_hullfaces(uint8_t *data, size_t n, bsm_header_ext_hulls_t *header, bsm_hullface_t *hullfaces);
+bool bsm_read_hulledges(uint8_t *data, size_t n, bsm_header_ext_hulls_t *header, bsm_hulledge_t *hulledges);
+
+/* reads a 64-bit offset extension header -- returns false if the file is not a valid BSM model or does not carry the extension */
+bool bsm_read_header_ext_64(uint8_t *data, size_t n, bsm_header_ext_64_t *header);
+/* reads any valid header into the 64-bit form, widening the v1 fields unless the file carries the extension */
+bool bsm_read_header_64(uint8_t *data, size_t n, bsm_header_ext_64_t *header);
+
+uint64_t bsm_chunk_offs_64(bsm_header_ext_64_t *header, bsm_chunk_t chunk);
+uint64_t bsm_chunk_bytes_64(bsm_header_ext_64_t *header, bsm_chunk_t chunk);
+/* decodes a whole chunk into a buffer of bsm_chunk_bytes_64() -- normals and tangents are normalized as by bsm_read_normals() */
+bool bsm_read_chunk_64(uint8_t *data, size_t n, bsm_header_ext_64_t *header, bsm_chunk_t chunk, void *out);
+
+/* reads a tiling extension header -- returns false if the file is not a valid BSM model or does not carry the extension */
+bool bsm_read_header_ext_tiles(uint8_t *data, size_t n, bsm_header_ext_tiles_t *header);
+
+size_t bsm_tiles_bytes(bsm_header_ext_tiles_t *header);
+bool bsm_read_tiles(uint8_t *data, size_t n, bsm_header_ext_tiles_t *header, bsm_tile_t *tiles);
+
+/* streaming by region: the query functions list the tiles whose bbox intersects a box, or lies within sphere->radius of
+ * the sphere center, and return their number.  bsm_read_tile() then decodes only that tile -- triangles come back with
+ * tile-local vertex indices and meshes with tile-local triangle ranges.  any output pointer may be NULL to skip that chunk */
+int32_t bsm_query_tiles_bbox(bsm_header_ext_tiles_t *header, bsm_tile_t *tiles, bsm_bbox_t *bbox, int32_t *select);
+int32_t bsm_query_tiles_sphere(bsm_header_ext_tiles_t *header, bsm_tile_t *tiles, bsm_bsphere_t *sphere, int32_t *select);
+bool bsm_read_tile(uint8_t *data, size_t n, bsm_header_ext_tiles_t *header, bsm_tile_t *tile, bsm_position_t *positions, bsm_texcoord_t *texcoords, bsm_normal_t *normals, bsm_tangent_t *tangents, bsm_triangle_t *tris, bsm_mesh_t *meshes);
+
+/* partial loading of selected meshes:
+ * 1. bsm_submesh_tris() returns the number of triangles in the selection, or -1 if the selection is invalid
+ * 2. bsm_read_submesh_tris() decodes only those triangles (and, optionally, the selected meshes rebased onto them)
+ * 3. bsm_submesh_remap() rewrites the triangles to local indices and lists the referenced global vertices in
+ *    ascending order in verts -- returns the local vertex count, or -1 on error.  bsm_submesh_remap_ranged() takes
+ *    the vertices from the selected meshes' ranges instead of scanning the triangles, so it lists every vertex in
+ *    those ranges, including ones no selected triangle references, and fails if a triangle leaves them.
+ *    remap is scratch space of bsm_submesh_remap_bytes() and verts must hold up to header->num_verts entries.
+ * 4. bsm_gather_*() decodes only the listed vertices from each attribute chunk */
+int32_t bsm_submesh_tris(bsm_header_v1_t *header, bsm_mesh_t *meshes, int32_t *select, int32_t num_select);
+bool bsm_read_submesh_tris(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_mesh_t *meshes, int32_t *select, int32_t num_select, bsm_triangle_t *tris, bsm_mesh_t *submeshes);
+size_t bsm_submesh_remap_bytes(bsm_header_v1_t *header);
+int32_t bsm_submesh_remap(bsm_header_v1_t *header, bsm_triangle_t *tris, int32_t num_tris, int32_t *remap, int32_t *verts);
+int32_t bsm_submesh_remap_ranged(bsm_header_v1_t *header, bsm_vertrange_t *vertranges, int32_t *select, int32_t num_select, bsm_triangle_t *tris, int32_t num_tris, int32_t *remap, int32_t *verts);
+bool bsm_gather_positions(uint8_t *data, size_t n, bsm_header_v1_t *header, int32_t *verts, int32_t num_verts, bsm_position_t *positions);
+bool bsm_gather_texcoords(uint8_t *data, size_t n, bsm_header_v1_t *header, int32_t *verts, int32_t num_verts, bsm_texcoord_t *texcoords);
+bool bsm_gather_normals(uint8_t *data, size_t n, bsm_header_v1_t *header, int32_t *verts, int32_t num_verts, bsm_normal_t *normals);
+bool bsm_gather_tangents(uint8_t *data, size_t n, bsm_header_v1_t *header, int32_t *verts, int32_t num_verts, bsm_tangent_t *tangents);
+
+/* writing -- initialize a header, fill in the counts, then let bsm_layout_*() assign contiguous chunk offsets starting at offs.
+ * the layout functions return the total file size; chunks are written into a buffer of at least that size.  the 32-bit
+ * layouts return 0 if a count is negative or the file would not fit in INT32_MAX bytes (see bsm_layout_ext_64()) */
+void bsm_init_header_v1(bsm_header_v1_t *header, int32_t extension);
+size_t bsm_layout_v1(bsm_header_v1_t *header, size_t offs);
+size_t bsm_layout_ext_vertranges(bsm_header_ext_vertranges_t *header);
+size_t bsm_layout_ext_hulls(bsm_header_ext_hulls_t *header);
+/* lays out the 64-bit counts (set up the v1 header with bsm_init_header_v1(&header->header_v1, BSM_EXT_64) first) and
+ * mirrors them into the v1 fields if the file fits in 32 bits -- returns the file size, or 0 if a count is out of range */
+uint64_t bsm_layout_ext_64(bsm_header_ext_64_t *header);
+/* num_tiles must be set before layout */
+size_t bsm_layout_ext_tiles(bsm_header_ext_tiles_t *header);
+
+/* lays out and writes a complete v1 model -- bsm_layout_model() returns the file size, or 0 if it is too large */
+size_t bsm_layout_model(bsm_model_t *model);
+bool bsm_write_model(uint8_t *data, size_t n, bsm_model_t *model);
+
+bool bsm_write_header_v1(uint8_t *data, size_t n, bsm_header_v1_t *header);
+bool bsm_write_positions(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_position_t *positions);
+bool bsm_write_texcoords(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_texcoord_t *texcoords);
+bool bsm_write_normals(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_normal_t *normals);
+bool bsm_write_tangents(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_tangent_t *tangents);
+bool bsm_write_tris(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_triangle_t *tris);
+bool bsm_write_meshes(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_mesh_t *meshes);
+bool bsm_write_hullverts(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_hullvert_t *hullverts);
+bool bsm_write_hulls(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_hull_t *hulls);
+bool bsm_write_visverts(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_visvert_t *visverts);
+bool bsm_write_vistris(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_vistri_t *vistris);
+
+bool bsm_write_header_ext_vertranges(uint8_t *data, size_t n, bsm_header_ext_vertranges_t *header);
+bool bsm_write_vertranges(uint8_t *data, size_t n, bsm_header_ext_vertranges_t *header, bsm_vertrange_t *vertranges);
+
+bool bsm_write_header_ext_hulls(uint8_t *data, size_t n, bsm_header_ext_hulls_t *header);
+bool bsm_write_hulltopos(uint8_t *data, size_t n, bsm_header_ext_hulls_t *header, bsm_hulltopo_t *hulltopos);
+bool bsm_write_hullfaces(uint8_t *data, size_t n, bsm_header_ext_hulls_t *header, bsm_hullface_t *hullfaces);
+bool bsm_write_hulledges(uint8_t *data, size_t n, bsm_header_ext_hulls_t *header, bsm_hulledge_t *hulledges);
+
+bool bsm_write_header_ext_64(uint8_t *data, size_t n, bsm_header_ext_64_t *header);
+bool bsm_write_chunk_64(uint8_t *data, size_t n, bsm_header_ext_64_t *header, bsm_chunk_t chunk, const void *src);
+
+bool bsm_write_header_ext_tiles(uint8_t *data, size_t n, bsm_header_ext_tiles_t *header);
+bool bsm_write_tiles(uint8_t *data, size_t n, bsm_header_ext_tiles_t *header, bsm_tile_t *tiles);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* LIBBSM_H */
\ No newline at end of file
@@ -0,0 +1,390 @@
+#ifndef LIBBSM_HPP
+#define LIBBSM_HPP
+
+/* header-only C++17 layer over libbsm: struct layouts are checked at compile time, chunks are handed out as typed spans
+ * and decode kernels are picked at compile time by host byte order and requested output format.  link with libbsm as usual */
+
+#include "bsm.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#if __cplusplus >= 202002L
+#include <bit>
+#include <span>
+#endif
+
+namespace bsm {
+
+/* the on-disk layout -- these are the sizes bsm.c asserts at runtime */
+static_assert(sizeof(bsm_header_v1_t) == 0x84, "bsm_header_v1_t layout");
+static_assert(sizeof(bsm_position_t) == 0x0C, "bsm_position_t layout");
+static_assert(sizeof(bsm_texcoord_t) == 0x08, "bsm_texcoord_t layout");
+static_assert(sizeof(bsm_normal_t) == 0x0C, "bsm_normal_t layout");
+static_assert(sizeof(bsm_tangent_t) == 0x10, "bsm_tangent_t layout");
+static_assert(sizeof(bsm_triangle_t) == 0x0C, "bsm_triangle_t layout");
+static_assert(sizeof(bsm_mesh_t) == 0x108, "bsm_mesh_t layout");
+static_assert(sizeof(bsm_hullvert_t) == 0x0C, "bsm_hullvert_t layout");
+static_assert(sizeof(bsm_hull_t) == 0x08, "bsm_hull_t layout");
+static_assert(sizeof(bsm_visvert_t) == 0x0C, "bsm_visvert_t layout");
+static_assert(sizeof(bsm_vistri_t) == 0x0C, "bsm_vistri_t layout");
+static_assert(sizeof(bsm_vertrange_t) == 0x08, "bsm_vertrange_t layout");
+static_assert(sizeof(bsm_header_ext_vertranges_t) == 0x8C, "bsm_header_ext_vertranges_t layout");
+static_assert(sizeof(bsm_hulltopo_t) == 0x10, "bsm_hulltopo_t layout");
+static_assert(sizeof(bsm_hullface_t) == 0x18, "bsm_hullface_t layout");
+static_assert(sizeof(bsm_hulledge_t) == 0x0C, "bsm_hulledge_t layout");
+static_assert(sizeof(bsm_header_ext_hulls_t) == 0x9C, "bsm_header_ext_hulls_t layout");
+static_assert(sizeof(bsm_header_ext_64_t) == 0x110, "bsm_header_ext_64_t layout");
+static_assert(sizeof(bsm_tile_t) == 0x30, "bsm_tile_t layout");
+static_assert(sizeof(bsm_header_ext_tiles_t) == 0x8C, "bsm_header_ext_tiles_t layout");
+
+/* every header field at its spec address -- a size check alone would miss reordered or re-padded fields */
+#define BSM_ASSERT_FIELD(type, field, offs) static_assert(offsetof(type, field) == offs, #type "::" #field " offset");
+BSM_ASSERT_FIELD(bsm_header_v1_t, magic, 0x00)
+BSM_ASSERT_FIELD(bsm_header_v1_t, version, 0x10)
+BSM_ASSERT_FIELD(bsm_header_v1_t, extension, 0x14)
+BSM_ASSERT_FIELD(bsm_header_v1_t, bsphere, 0x18)
+BSM_ASSERT_FIELD(bsm_header_v1_t, bbox, 0x28)
+BSM_ASSERT_FIELD(bsm_header_v1_t, num_verts, 0x40)
+BSM_ASSERT_FIELD(bsm_header_v1_t, offs_positions, 0x44)
+BSM_ASSERT_FIELD(bsm_header_v1_t, offs_texcoords, 0x48)
+BSM_ASSERT_FIELD(bsm_header_v1_t, offs_normals, 0x4C)
+BSM_ASSERT_FIELD(bsm_header_v1_t, offs_tangents, 0x50)
+BSM_ASSERT_FIELD(bsm_header_v1_t, num_tris, 0x54)
+BSM_ASSERT_FIELD(bsm_header_v1_t, offs_tris, 0x58)
+BSM_ASSERT_FIELD(bsm_header_v1_t, num_meshes, 0x5C)
+BSM_ASSERT_FIELD(bsm_header_v1_t, offs_meshes, 0x60)
+BSM_ASSERT_FIELD(bsm_header_v1_t, num_hullverts, 0x64)
+BSM_ASSERT_FIELD(bsm_header_v1_t, offs_hullverts, 0x68)
+BSM_ASSERT_FIELD(bsm_header_v1_t, num_hulls, 0x6C)
+BSM_ASSERT_FIELD(bsm_header_v1_t, offs_hulls, 0x70)
+BSM_ASSERT_FIELD(bsm_header_v1_t, num_visverts, 0x74)
+BSM_ASSERT_FIELD(bsm_header_v1_t, offs_visverts, 0x78)
+BSM_ASSERT_FIELD(bsm_header_v1_t, num_vistris, 0x7C)
+BSM_ASSERT_FIELD(bsm_header_v1_t, offs_vistris, 0x80)
+BSM_ASSERT_FIELD(bsm_header_ext_vertranges_t, num_vertranges, 0x84)
+BSM_ASSERT_FIELD(bsm_header_ext_vertranges_t, offs_vertranges, 0x88)
+BSM_ASSERT_FIELD(bsm_header_ext_hulls_t, num_hulltopos, 0x84)
+BSM_ASSERT_FIELD(bsm_header_ext_hulls_t, offs_hulltopos, 0x88)
+BSM_ASSERT_FIELD(bsm_header_ext_hulls_t, num_hullfaces, 0x8C)
+BSM_ASSERT_FIELD(bsm_header_ext_hulls_t, offs_hullfaces, 0x90)
+BSM_ASSERT_FIELD(bsm_header_ext_hulls_t, num_hulledges, 0x94)
+BSM_ASSERT_FIELD(bsm_header_ext_hulls_t, offs_hulledges, 0x98)
+BSM_ASSERT_FIELD(bsm_header_ext_64_t, reserved, 0x84)
+BSM_ASSERT_FIELD(bsm_header_ext_64_t, num_verts, 0x88)
+BSM_ASSERT_FIELD(bsm_header_ext_64_t, offs_positions, 0x90)
+BSM_ASSERT_FIELD(bsm_header_ext_64_t, offs_texcoords, 0x98)
+BSM_ASSERT_FIELD(bsm_header_ext_64_t, offs_normals, 0xA0)
+BSM_ASSERT_FIELD(bsm_header_ext_64_t, offs_tangents, 0xA8)
+BSM_ASSERT_FIELD(bsm_header_ext_64_t, num_tris, 0xB0)
+BSM_ASSERT_FIELD(bsm_header_ext_64_t, offs_tris, 0xB8)
+BSM_ASSERT_FIELD(bsm_header_ext_64_t, num_meshes, 0xC0)
+BSM_ASSERT_FIELD(bsm_header_ext_64_t, offs_meshes, 0xC8)
+BSM_ASSERT_FIELD(bsm_header_ext_64_t, num_hullverts, 0xD0)
+BSM_ASSERT_FIELD(bsm_header_ext_64_t, offs_hullverts, 0xD8)
+BSM_ASSERT_FIELD(bsm_header_ext_64_t, num_hulls, 0xE0)
+BSM_ASSERT_FIELD(bsm_header_ext_64_t, offs_hulls, 0xE8)
+BSM_ASSERT_FIELD(bsm_header_ext_64_t, num_visverts, 0xF0)
+BSM_ASSERT_FIELD(bsm_header_ext_64_t, offs_visverts, 0xF8)
+BSM_ASSERT_FIELD(bsm_header_ext_64_t, num_vistris, 0x100)
+BSM_ASSERT_FIELD(bsm_header_ext_64_t, offs_vistris, 0x108)
+BSM_ASSERT_FIELD(bsm_header_ext_tiles_t, num_tiles, 0x84)
+BSM_ASSERT_FIELD(bsm_header_ext_tiles_t, offs_tiles, 0x88)
+#undef BSM_ASSERT_FIELD
+
+/* libbsm is built little-endian unless BIGENDIAN is defined, and so is this layer */
+#ifdef BIGENDIAN
+inline constexpr bool little_endian = false;
+#else
+inline constexpr bool little_endian = true;
+#endif
+#if __cplusplus >= 202002L
+static_assert(little_endian == (std::endian::native == std::endian::little), "define BIGENDIAN on big-endian targets");
+#endif
+
+#if __cplusplus >= 202002L
+template <class T> using span = std::span<T>;
+#else
+/* the subset of std::span used here */
+template <class T> class span {
+public:
+  constexpr span() noexcept : data_(nullptr), size_(0) {}
+  constexpr span(T *data, size_t size) noexcept : data_(data), size_(size) {}
+  template <class U, class = std::enable_if_t<std::is_convertible_v<U(*)[], T(*)[]>>>
+  constexpr span(const span<U> &other) noexcept : data_(other.data()), size_(other.size()) {}
+  
+  constexpr T *data() const noexcept { return data_; }
+  constexpr size_t size() const noexcept { return size_; }
+  constexpr size_t size_bytes() const noexcept { return size_ * sizeof(T); }
+  constexpr bool empty() const noexcept { return size_ == 0; }
+  constexpr T *begin() const noexcept { return data_; }
+  constexpr T *end() const noexcept { return data_ + size_; }
+  constexpr T &operator[](size_t i) const noexcept { return data_[i]; }
+  constexpr span subspan(size_t offs, size_t count) const noexcept { return span(data_ + offs, count); }
+
+private:
+  T *data_;
+  size_t size_;
+};
+#endif
+
+/* per-chunk element type, header fields and model member -- 'unit' chunks are normalized on decode */
+template <bsm_chunk_t C> struct chunk_traits;
+
+#define BSM_CHUNK_TRAITS(chunk, elem, num, offs, member, is_unit) \
+  template <> struct chunk_traits<chunk> { \
+    using type = elem; \
+    static constexpr int32_t bsm_header_v1_t::*count = &bsm_header_v1_t::num; \
+    static constexpr int32_t bsm_header_v1_t::*offset = &bsm_header_v1_t::offs; \
+    static constexpr elem *bsm_model_t::*field = &bsm_model_t::member; \
+    static constexpr bool unit = is_unit; \
+  };
+BSM_CHUNK_TRAITS(BSM_CHUNK_POSITIONS, bsm_position_t, num_verts,     offs_positions, positions, false)
+BSM_CHUNK_TRAITS(BSM_CHUNK_TEXCOORDS, bsm_texcoord_t, num_verts,     offs_texcoords, texcoords, false)
+BSM_CHUNK_TRAITS(BSM_CHUNK_NORMALS,   bsm_normal_t,   num_verts,     offs_normals,   normals,   true)
+BSM_CHUNK_TRAITS(BSM_CHUNK_TANGENTS,  bsm_tangent_t,  num_verts,     offs_tangents,  tangents,  true)
+BSM_CHUNK_TRAITS(BSM_CHUNK_TRIS,      bsm_triangle_t, num_tris,      offs_tris,      tris,      false)
+BSM_CHUNK_TRAITS(BSM_CHUNK_MESHES,    bsm_mesh_t,     num_meshes,    offs_meshes,    meshes,    false)
+BSM_CHUNK_TRAITS(BSM_CHUNK_HULLVERTS, bsm_hullvert_t, num_hullverts, offs_hullverts, hullverts, false)
+BSM_CHUNK_TRAITS(BSM_CHUNK_HULLS,     bsm_hull_t,     num_hulls,     offs_hulls,     hulls,     false)
+BSM_CHUNK_TRAITS(BSM_CHUNK_VISVERTS,  bsm_visvert_t,  num_visverts,  offs_visverts,  visverts,  false)
+BSM_CHUNK_TRAITS(BSM_CHUNK_VISTRIS,   bsm_vistri_t,   num_vistris,   offs_vistris,   vistris,   false)
+#undef BSM_CHUNK_TRAITS
+
+template <bsm_chunk_t C> using chunk_t = typename chunk_traits<C>::type;
+
+/* a chunk can be viewed in place, without decoding, when the file byte order is the host's and nothing is normalized */
+template <bsm_chunk_t C> inline constexpr bool zero_copy = little_endian && !chunk_traits<C>::unit;
+
+/* alternative output formats for decode() */
+struct snorm16x4 {
+  int16_t x, y, z, w;  /* w is the tangent handedness, 0 for normals */
+};
+
+struct tri16 {
+  uint16_t index[3];
+};
+
+namespace detail {
+
+template <bool Little> inline uint32_t load32(const uint8_t *src) {
+  uint32_t x;
+  std::memcpy(&x, src, 4);
+  if constexpr (!Little) x = (x & 0x000000FF) << 24 | (x & 0x0000FF00) << 8 | (x & 0x00FF0000) >> 8 | (x & 0xFF000000) >> 24;
+  return x;
+}
+
+/* copies count elements of 32-bit words from file to host order */
+template <class T> inline void copy32(const uint8_t *src, size_t count, T *out) {
+  static_assert(sizeof(T) % 4 == 0, "chunk elements are made of 32-bit words");
+  if constexpr (little_endian) {
+    std::memcpy(out, src, count * sizeof(T));
+  } else {
+    uint8_t *dst = reinterpret_cast<uint8_t*>(out);
+    for (size_t i = 0; i < count * sizeof(T); i += 4) {
+      uint32_t x = load32<false>(src + i);
+      std::memcpy(dst + i, &x, 4);
+    }
+  }
+}
+
+inline float length(float x, float y, float z) {
+  return std::sqrt(x * x + y * y + z * z);
+}
+
+inline int16_t snorm16(float x) {
+  x = x < -1.0f ? -1.0f : x > 1.0f ? 1.0f : x;
+  return static_cast<int16_t>(std::lround(x * 32767.0f));
+}
+
+template <class T> inline void normalize(T &v) {
+  float m = length(v.x, v.y, v.z);
+  v.x /= m;
+  v.y /= m;
+  v.z /= m;
+  if constexpr (std::is_same_v<T, bsm_tangent_t>) v.handedness = v.handedness >= 0.0f ? 1.0f : -1.0f;
+}
+
+} /* namespace detail */
+
+/* decode kernels -- decoder<C, Out>::run() converts count encoded elements of chunk C into Out, returning false if an
+ * element does not fit the output format.  a chunk/format pair without a kernel does not compile */
+template <bsm_chunk_t C, class Out, class = void> struct decoder;
+
+/* native format: the C struct, normalized like bsm_read_normals() / bsm_read_tangents() */
+template <bsm_chunk_t C> struct decoder<C, chunk_t<C>> {
+  static bool run(const uint8_t *src, size_t count, chunk_t<C> *out) {
+    detail::copy32(src, count, out);
+    if constexpr (chunk_traits<C>::unit) {
+      for (size_t i = 0; i < count; i++) detail::normalize(out[i]);
+    }
+    return true;
+  }
+};
+
+/* packed unit vectors for vertex buffers */
+template <bsm_chunk_t C> struct decoder<C, snorm16x4, std::enable_if_t<chunk_traits<C>::unit>> {
+  static bool run(const uint8_t *src, size_t count, snorm16x4 *out) {
+    constexpr size_t words = sizeof(chunk_t<C>) / 4;
+    for (size_t i = 0; i < count; i++) {
+      float v[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+      for (size_t k = 0; k < words; k++) {
+        uint32_t x = detail::load32<little_endian>(src + (i * words + k) * 4);
+        std::memcpy(&v[k], &x, 4);
+      }
+      float m = detail::length(v[0], v[1], v[2]);
+      out[i].x = detail::snorm16(v[0] / m);
+      out[i].y = detail::snorm16(v[1] / m);
+      out[i].z = detail::snorm16(v[2] / m);
+      out[i].w = words == 4 ? (v[3] >= 0.0f ? 32767 : -32767) : 0;
+    }
+    return true;
+  }
+};
+
+/* 16-bit triangle indices, for models of up to 65536 vertices */
+template <bsm_chunk_t C> struct decoder<C, tri16, std::enable_if_t<C == BSM_CHUNK_TRIS || C == BSM_CHUNK_VISTRIS>> {
+  static bool run(const uint8_t *src, size_t count, tri16 *out) {
+    /* every index is checked before any is written, so a failed decode leaves out untouched */
+    for (size_t i = 0; i < count * 3; i++) {
+      if (detail::load32<little_endian>(src + i * 4) > 0xFFFF) return false;
+    }
+    for (size_t i = 0; i < count * 3; i++) {
+      out[i / 3].index[i % 3] = static_cast<uint16_t>(detail::load32<little_endian>(src + i * 4));
+    }
+    return true;
+  }
+};
+
+/* move-only owner of a byte buffer, zero-filled on construction */
+class buffer {
+public:
+  buffer() noexcept : size_(0) {}
+  explicit buffer(size_t size) : data_(new uint8_t[size > 0 ? size : 1]()), size_(size) {}
+  buffer(buffer &&other) noexcept : data_(std::move(other.data_)), size_(std::exchange(other.size_, 0)) {}
+  buffer &operator=(buffer &&other) noexcept {
+    if (this != &other) {
+      data_ = std::move(other.data_);
+      size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+  }
+  buffer(const buffer&) = delete;
+  buffer &operator=(const buffer&) = delete;
+  
+  uint8_t *data() noexcept { return data_.get(); }
+  const uint8_t *data() const noexcept { return data_.get(); }
+  size_t size() const noexcept { return size_; }
+  span<uint8_t> bytes() noexcept { return span<uint8_t>(data_.get(), size_); }
+  span<const uint8_t> bytes() const noexcept { return span<const uint8_t>(data_.get(), size_); }
+
+private:
+  std::unique_ptr<uint8_t[]> data_;
+  size_t size_;
+};
+
+/* a validated view of an encoded file -- the data must outlive the view.  the header is checked once by open(), so
+ * chunk access needs no further bounds checks */
+class file {
+public:
+  static std::optional<file> open(span<const uint8_t> data) {
+    file f(data);
+    if (!bsm_read_header_v1(const_cast<uint8_t*>(data.data()), data.size(), &f.header_)) return std::nullopt;
+    return f;
+  }
+  
+  const bsm_header_v1_t &header() const noexcept { return header_; }
+  
+  template <bsm_chunk_t C> size_t count() const noexcept {
+    return static_cast<size_t>(header_.*chunk_traits<C>::count);
+  }
+  
+  /* the encoded bytes of a chunk */
+  template <bsm_chunk_t C> span<const uint8_t> encoded() const noexcept {
+    return data_.subspan(static_cast<size_t>(header_.*chunk_traits<C>::offset), count<C>() * sizeof(chunk_t<C>));
+  }
+  
+  /* the chunk in place -- only for zero_copy<C> chunks, and empty if the chunk is not aligned for its element type */
+  template <bsm_chunk_t C> std::optional<span<const chunk_t<C>>> view() const noexcept {
+    static_assert(zero_copy<C>, "chunk must be decoded on this target");
+    span<const uint8_t> bytes = encoded<C>();
+    if (reinterpret_cast<uintptr_t>(bytes.data()) % alignof(chunk_t<C>) != 0) return std::nullopt;
+    return span<const chunk_t<C>>(reinterpret_cast<const chunk_t<C>*>(bytes.data()), count<C>());
+  }
+  
+  /* decodes a chunk into out, which must hold count<C>() elements */
+  template <bsm_chunk_t C, class Out = chunk_t<C>> bool decode(span<Out> out) const {
+    if (out.size() < count<C>()) return false;
+    return decoder<C, Out>::run(encoded<C>().data(), count<C>(), out.data());
+  }
+
+private:
+  explicit file(span<const uint8_t> data) noexcept : data_(data), header_() {}
+  
+  span<const uint8_t> data_;
+  bsm_header_v1_t header_;
+};
+
+/* owning, move-only bsm_model_t -- released with bsm_free_model() */
+class model {
+public:
+  model() noexcept : model_() {}
+  model(model &&other) noexcept : model_(std::exchange(other.model_, bsm_model_t())) {}
+  model &operator=(model &&other) noexcept {
+    if (this != &other) {
+      bsm_free_model(&model_);
+      model_ = std::exchange(other.model_, bsm_model_t());
+    }
+    return *this;
+  }
+  model(const model&) = delete;
+  model &operator=(const model&) = delete;
+  ~model() { bsm_free_model(&model_); }
+  
+  static std::optional<model> read(span<const uint8_t> data) {
+    model m;
+    if (!bsm_read_model(const_cast<uint8_t*>(data.data()), data.size(), &m.model_)) return std::nullopt;
+    return m;
+  }
+  
+  /* zero-filled chunks for the counts in header */
+  static std::optional<model> alloc(const bsm_header_v1_t &header) {
+    model m;
+    m.model_.header = header;
+    if (!bsm_alloc_model(&m.model_)) return std::nullopt;
+    return m;
+  }
+  
+  bsm_model_t *get() noexcept { return &model_; }
+  const bsm_model_t *get() const noexcept { return &model_; }
+  bsm_header_v1_t &header() noexcept { return model_.header; }
+  const bsm_header_v1_t &header() const noexcept { return model_.header; }
+  
+  template <bsm_chunk_t C> span<chunk_t<C>> chunk() noexcept {
+    return span<chunk_t<C>>(model_.*chunk_traits<C>::field, static_cast<size_t>(model_.header.*chunk_traits<C>::count));
+  }
+  template <bsm_chunk_t C> span<const chunk_t<C>> chunk() const noexcept {
+    return span<const chunk_t<C>>(model_.*chunk_traits<C>::field, static_cast<size_t>(model_.header.*chunk_traits<C>::count));
+  }
+  
+  /* lays out and encodes the model */
+  std::optional<buffer> write() {
+    size_t size = bsm_layout_model(&model_);
+    if (size == 0) return std::nullopt;
+    buffer out(size);
+    if (!bsm_write_model(out.data(), out.size(), &model_)) return std::nullopt;
+    return out;
+  }
+
+private:
+  bsm_model_t model_;
+};
+
+} /* namespace bsm */
+
+#endif /* LIBBSM_HPP */
@@ -0,0 +1,318 @@
+#include "bsm_batch.h"
+#include "bsm_parallel.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+static uint32_t material_hash(const uint8_t *material) {
+  uint32_t h = 2166136261u;
+  for (int i = 0; i < 256 && material[i] != 0; i++) {
+    h = (h ^ material[i]) * 16777619u;
+  }
+  return h;
+}
+
+static bool material_equal(const uint8_t *a, const uint8_t *b) {
+  return strncmp((const char*)a, (const char*)b, 256) == 0;
+}
+
+static float32_t det3(const float32_t *m) {
+  return m[0] * (m[5] * m[10] - m[9] * m[6])
+       - m[4] * (m[1] * m[10] - m[9] * m[2])
+       + m[8] * (m[1] * m[6]  - m[5] * m[2]);
+}
+
+static void normalize3(float32_t *x, float32_t *y, float32_t *z) {
+  float32_t m = sqrtf(*x * *x + *y * *y + *z * *z);
+  if (m <= 0.0f) return;
+  *x /= m;
+  *y /= m;
+  *z /= m;
+}
+
+/* transforms one instance's vertex attributes into dst, starting at base */
+static void batch_verts(const float32_t *m, bsm_model_t *src, bsm_model_t *dst, int32_t base) {
+  /* normals go through the cofactor matrix (the inverse transpose scaled by the determinant) */
+  float32_t s = det3(m) < 0.0f ? -1.0f : 1.0f;
+  float32_t c[9] = {
+    s * (m[5] * m[10] - m[9] * m[6]), s * (m[8] * m[6] - m[4] * m[10]), s * (m[4] * m[9] - m[8] * m[5]),
+    s * (m[9] * m[2] - m[1] * m[10]), s * (m[0] * m[10] - m[8] * m[2]), s * (m[8] * m[1] - m[0] * m[9]),
+    s * (m[1] * m[6] - m[5] * m[2]),  s * (m[4] * m[2] - m[0] * m[6]),  s * (m[0] * m[5] - m[4] * m[1])
+  };
+  
+  bsm_position_t *pos = &dst->positions[base];
+  bsm_normal_t   *nor = &dst->normals[base];
+  bsm_tangent_t  *tan = &dst->tangents[base];
+  for (int32_t i = 0; i < src->header.num_verts; i++) {
+    bsm_position_t p = src->positions[i];
+    pos[i].x = m[0] * p.x + m[4] * p.y + m[8]  * p.z + m[12];
+    pos[i].y = m[1] * p.x + m[5] * p.y + m[9]  * p.z + m[13];
+    pos[i].z = m[2] * p.x + m[6] * p.y + m[10] * p.z + m[14];
+  }
+  for (int32_t i = 0; i < src->header.num_verts; i++) {
+    bsm_normal_t n = src->normals[i];
+    nor[i].x = c[0] * n.x + c[1] * n.y + c[2] * n.z;
+    nor[i].y = c[3] * n.x + c[4] * n.y + c[5] * n.z;
+    nor[i].z = c[6] * n.x + c[7] * n.y + c[8] * n.z;
+    normalize3(&nor[i].x, &nor[i].y, &nor[i].z);
+  }
+  for (int32_t i = 0; i < src->header.num_verts; i++) {
+    bsm_tangent_t t = src->tangents[i];
+    tan[i].x = m[0] * t.x + m[4] * t.y + m[8]  * t.z;
+    tan[i].y = m[1] * t.x + m[5] * t.y + m[9]  * t.z;
+    tan[i].z = m[2] * t.x + m[6] * t.y + m[10] * t.z;
+    tan[i].handedness = s * t.handedness;
+    normalize3(&tan[i].x, &tan[i].y, &tan[i].z);
+  }
+  memcpy(&dst->texcoords[base], src->texcoords, src->header.num_verts * sizeof(bsm_texcoord_t));
+}
+
+static void batch_points(const float32_t *m, const float32_t *src, float32_t *dst, int32_t num) {
+  for (int32_t i = 0; i < num; i++) {
+    const float32_t *p = &src[i*3];
+    dst[i*3+0] = m[0] * p[0] + m[4] * p[1] + m[8]  * p[2] + m[12];
+    dst[i*3+1] = m[1] * p[0] + m[5] * p[1] + m[9]  * p[2] + m[13];
+    dst[i*3+2] = m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14];
+  }
+}
+
+static void batch_bounds(bsm_model_t *batch) {
+  bsm_header_v1_t *header = &batch->header;
+  if (header->num_verts == 0) return;
+  
+  bsm_bbox_t box = { INFINITY, INFINITY, INFINITY, -INFINITY, -INFINITY, -INFINITY };
+  for (int32_t i = 0; i < header->num_verts; i++) {
+    bsm_position_t p = batch->positions[i];
+    box.x0 = fminf(box.x0, p.x);
+    box.y0 = fminf(box.y0, p.y);
+    box.z0 = fminf(box.z0, p.z);
+    box.x1 = fmaxf(box.x1, p.x);
+    box.y1 = fmaxf(box.y1, p.y);
+    box.z1 = fmaxf(box.z1, p.z);
+  }
+  
+  /* centered on the box -- looser than the exporter's minimal sphere, but always conservative */
+  bsm_bsphere_t sphere = { 0.5f * (box.x0 + box.x1), 0.5f * (box.y0 + box.y1), 0.5f * (box.z0 + box.z1), 0.0f };
+  float32_t r2 = 0.0f;
+  for (int32_t i = 0; i < header->num_verts; i++) {
+    bsm_position_t p = batch->positions[i];
+    float32_t dx = p.x - sphere.x;
+    float32_t dy = p.y - sphere.y;
+    float32_t dz = p.z - sphere.z;
+    r2 = fmaxf(r2, dx * dx + dy * dy + dz * dz);
+  }
+  sphere.radius = sqrtf(r2);
+  header->bbox = box;
+  header->bsphere = sphere;
+}
+
+/* where one instance starts in each chunk of the batch, and its first range */
+typedef struct batch_base {
+  int32_t vert;
+  int32_t hullvert;
+  int32_t hull;
+  int32_t visvert;
+  int32_t vistri;
+  int32_t range;
+} batch_base_t;
+
+typedef struct batch_job {
+  bsm_model_t *models;
+  bsm_batch_instance_t *instances;
+  bsm_model_t *batch;
+  bsm_batch_range_t *ranges;
+  batch_base_t *bases;
+} batch_job_t;
+
+/* copies one instance into the places laid out for it -- instances never write to the same place */
+static void batch_instance(void *arg, int32_t thread, int32_t i) {
+  batch_job_t *job = arg;
+  bsm_model_t *model = &job->models[job->instances[i].model];
+  bsm_header_v1_t *header = &model->header;
+  bsm_model_t *batch = job->batch;
+  batch_base_t *base = &job->bases[i];
+  const float32_t *m = job->instances[i].transform;
+  bool mirror = det3(m) < 0.0f;
+  
+  batch_verts(m, model, batch, base->vert);
+  for (int32_t j = 0; j < header->num_meshes; j++) {
+    bsm_mesh_t *mesh = &model->meshes[j];
+    bsm_triangle_t *dst = &batch->tris[job->ranges[base->range + j].idx_tris];
+    for (int32_t k = 0; k < mesh->num_tris; k++) {
+      bsm_triangle_t *tri = &model->tris[mesh->idx_tris + k];
+      dst[k].index[0] = tri->index[0] + base->vert;
+      dst[k].index[1] = tri->index[mirror ? 2 : 1] + base->vert;
+      dst[k].index[2] = tri->index[mirror ? 1 : 2] + base->vert;
+    }
+  }
+  
+  batch_points(m, &model->hullverts[0].x, &batch->hullverts[base->hullvert].x, header->num_hullverts);
+  for (int32_t j = 0; j < header->num_hulls; j++) {
+    batch->hulls[base->hull + j].idx_vert = model->hulls[j].idx_vert + base->hullvert;
+    batch->hulls[base->hull + j].num_vert = model->hulls[j].num_vert;
+  }
+  batch_points(m, &model->visverts[0].x, &batch->visverts[base->visvert].x, header->num_visverts);
+  for (int32_t j = 0; j < header->num_vistris; j++) {
+    bsm_vistri_t *tri = &model->vistris[j];
+    batch->vistris[base->vistri + j].index[0] = tri->index[0] + base->visvert;
+    batch->vistris[base->vistri + j].index[1] = tri->index[mirror ? 2 : 1] + base->visvert;
+    batch->vistris[base->vistri + j].index[2] = tri->index[mirror ? 1 : 2] + base->visvert;
+  }
+}
+
+static bool index_valid(const int32_t *index, int32_t num) {
+  return index[0] >= 0 && index[0] < num && index[1] >= 0 && index[1] < num && index[2] >= 0 && index[2] < num;
+}
+
+/* every index a source model carries has to point into its own chunks before it is rebased into the batch */
+static bool batch_valid(bsm_model_t *model) {
+  bsm_header_v1_t *header = &model->header;
+  for (int32_t i = 0; i < header->num_meshes; i++) {
+    bsm_mesh_t *mesh = &model->meshes[i];
+    if (mesh->idx_tris < 0 || mesh->num_tris < 0 || mesh->num_tris > header->num_tris - mesh->idx_tris) return false;
+  }
+  for (int32_t i = 0; i < header->num_tris; i++) {
+    if (!index_valid(model->tris[i].index, header->num_verts)) return false;
+  }
+  for (int32_t i = 0; i < header->num_hulls; i++) {
+    bsm_hull_t *hull = &model->hulls[i];
+    if (hull->idx_vert < 0 || hull->num_vert < 0 || hull->num_vert > header->num_hullverts - hull->idx_vert) return false;
+  }
+  for (int32_t i = 0; i < header->num_vistris; i++) {
+    if (!index_valid(model->vistris[i].index, header->num_visverts)) return false;
+  }
+  return true;
+}
+
+int32_t bsm_batch_ranges(bsm_model_t *models, int32_t num_models, bsm_batch_instance_t *instances, int32_t num_instances) {
+  int64_t total = 0;
+  for (int32_t i = 0; i < num_instances; i++) {
+    if (instances[i].model < 0 || instances[i].model >= num_models) return -1;
+    total += models[instances[i].model].header.num_meshes;
+  }
+  return total > INT32_MAX ? -1 : (int32_t)total;
+}
+
+bool bsm_batch_models(bsm_model_t *models, int32_t num_models, bsm_batch_instance_t *instances, int32_t num_instances, bsm_model_t *batch, bsm_batch_range_t *ranges) {
+  if (bsm_batch_ranges(models, num_models, instances, num_instances) < 0) return false;
+  
+  int32_t num_src = 0;
+  for (int32_t i = 0; i < num_models; i++) {
+    bsm_header_v1_t *header = &models[i].header;
+    if (!batch_valid(&models[i])) return false;
+    if (header->num_meshes > INT32_MAX / 2 - num_src) return false;
+    num_src += header->num_meshes;
+  }
+  
+  int64_t num_verts = 0, num_tris = 0, num_hullverts = 0, num_hulls = 0, num_visverts = 0, num_vistris = 0;
+  for (int32_t i = 0; i < num_instances; i++) {
+    bsm_header_v1_t *header = &models[instances[i].model].header;
+    if (det3(instances[i].transform) == 0.0f) return false;
+    num_verts     += header->num_verts;
+    num_hullverts += header->num_hullverts;
+    num_hulls     += header->num_hulls;
+    num_visverts  += header->num_visverts;
+    num_vistris   += header->num_vistris;
+    /* only triangles inside a mesh are carried over, once per mesh that covers them */
+    for (int32_t j = 0; j < header->num_meshes; j++) num_tris += models[instances[i].model].meshes[j].num_tris;
+  }
+  if (num_verts > INT32_MAX || num_tris > INT32_MAX || num_hullverts > INT32_MAX ||
+      num_hulls > INT32_MAX || num_visverts > INT32_MAX || num_vistris > INT32_MAX) return false;
+  
+  /* every source mesh is assigned a material group -- the groups become the meshes of the batch */
+  int32_t buckets = 16;
+  while (buckets < 2 * num_src) buckets *= 2;
+  int32_t  *first  = malloc((num_models + 1) * sizeof(int32_t));
+  int32_t  *group  = malloc((num_src + 1) * sizeof(int32_t));
+  int32_t  *table  = malloc(buckets * sizeof(int32_t));
+  uint8_t **owner  = malloc((num_src + 1) * sizeof(uint8_t*));
+  int64_t  *cursor = calloc(num_src + 1, sizeof(int64_t));
+  batch_base_t *bases = malloc((num_instances + 1) * sizeof(batch_base_t));
+  bool ok = first != NULL && group != NULL && table != NULL && owner != NULL && cursor != NULL && bases != NULL;
+  
+  int32_t num_groups = 0;
+  for (int32_t i = 0; ok && i < buckets; i++) table[i] = -1;
+  for (int32_t i = 0, k = 0; ok && i < num_models; i++) {
+    first[i] = k;
+    for (int32_t j = 0; j < models[i].header.num_meshes; j++, k++) {
+      uint8_t *material = models[i].meshes[j].material;
+      uint32_t slot = material_hash(material) & (buckets - 1);
+      while (table[slot] >= 0 && !material_equal(owner[table[slot]], material)) {
+        slot = (slot + 1) & (buckets - 1);
+      }
+      if (table[slot] < 0) {
+        table[slot] = num_groups;
+        owner[num_groups++] = material;
+      }
+      group[k] = table[slot];
+    }
+  }
+  
+  /* size each group, then turn the sizes into running triangle offsets */
+  for (int32_t i = 0; ok && i < num_instances; i++) {
+    bsm_model_t *model = &models[instances[i].model];
+    for (int32_t j = 0; j < model->header.num_meshes; j++) {
+      cursor[group[first[instances[i].model] + j]] += model->meshes[j].num_tris;
+    }
+  }
+  
+  memset(batch, 0, sizeof(bsm_model_t));
+  bsm_init_header_v1(&batch->header, 0);
+  batch->header.num_verts     = num_verts;
+  batch->header.num_tris      = num_tris;
+  batch->header.num_meshes    = num_groups;
+  batch->header.num_hullverts = num_hullverts;
+  batch->header.num_hulls     = num_hulls;
+  batch->header.num_visverts  = num_visverts;
+  batch->header.num_vistris   = num_vistris;
+  ok = ok && bsm_alloc_model(batch);
+  
+  int64_t offs = 0;
+  for (int32_t g = 0; ok && g < num_groups; g++) {
+    bsm_mesh_t *mesh = &batch->meshes[g];
+    mesh->idx_tris = offs;
+    mesh->num_tris = cursor[g];
+    memcpy(mesh->material, owner[g], sizeof(mesh->material));
+    cursor[g] = offs;
+    offs += mesh->num_tris;
+  }
+  
+  /* the destination of every instance is laid out up front, so the instances can be copied on separate threads */
+  batch_base_t base = { 0 };
+  for (int32_t i = 0; ok && i < num_instances; i++) {
+    bsm_model_t *model = &models[instances[i].model];
+    bsm_header_v1_t *header = &model->header;
+    bases[i] = base;
+    for (int32_t j = 0; j < header->num_meshes; j++) {
+      int32_t g = group[first[instances[i].model] + j];
+      ranges[base.range++] = (bsm_batch_range_t){ i, g, cursor[g], model->meshes[j].num_tris, base.vert, header->num_verts };
+      cursor[g] += model->meshes[j].num_tris;
+    }
+    base.vert     += header->num_verts;
+    base.hullvert += header->num_hullverts;
+    base.hull     += header->num_hulls;
+    base.visvert  += header->num_visverts;
+    base.vistri   += header->num_vistris;
+  }
+  if (ok) {
+    batch_job_t job = { models, instances, batch, ranges, bases };
+    bsm_parallel_for(num_instances, bsm_parallel_threads(num_instances, num_verts + num_tris), batch_instance, &job);
+  }
+  if (ok) batch_bounds(batch);
+  
+  /* offsets are 32-bit as well, so the whole file has to fit */
+  bsm_header_v1_t layout = batch->header;
+  if (ok && bsm_layout_v1(&layout, sizeof(bsm_header_v1_t)) == 0) {
+    bsm_free_model(batch);
+    ok = false;
+  }
+  
+  free(first);
+  free(group);
+  free(table);
+  free(owner);
+  free(cursor);
+  free(bases);
+  return ok;
+}
@@ -0,0 +1,41 @@
+#ifndef LIBBSM_BATCH_H
+#define LIBBSM_BATCH_H
+
+#include "bsm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* one placement of a source model -- transform is a column-major 4x4 matrix (affine part only is used) */
+typedef struct bsm_batch_instance {
+  int32_t model;
+  float32_t transform[16];
+} bsm_batch_instance_t;
+
+/* where one source mesh of one instance ended up in the combined model */
+typedef struct bsm_batch_range {
+  int32_t instance;
+  int32_t mesh;
+  int32_t idx_tris;
+  int32_t num_tris;
+  int32_t idx_vert;
+  int32_t num_vert;
+} bsm_batch_range_t;
+
+/* number of ranges bsm_batch_models() emits (one per instance per source mesh), or -1 if an instance is invalid */
+int32_t bsm_batch_ranges(bsm_model_t *models, int32_t num_models, bsm_batch_instance_t *instances, int32_t num_instances);
+
+/* transforms every instance into one vertex pool and merges meshes sharing a material string into a single mesh,
+ * rebasing triangle indices (and flipping the winding of mirrored instances).  triangles outside every mesh are left
+ * out, and a triangle covered by several meshes is copied into each of them.  collision hulls and occlusion geometry
+ * are transformed and appended as well.  bounds are recomputed, batch is allocated as by bsm_alloc_model() and
+ * ranges receives bsm_batch_ranges() entries.  returns false on invalid input (an index
+ * outside its source model included) or if the result exceeds the format */
+bool bsm_batch_models(bsm_model_t *models, int32_t num_models, bsm_batch_instance_t *instances, int32_t num_instances, bsm_model_t *batch, bsm_batch_range_t *ranges);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBBSM_BATCH_H */
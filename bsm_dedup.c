@@ -0,0 +1,388 @@
+#include "bsm_dedup.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+
+static uint64_t rotl64(uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+/* little-endian whatever the host, so hashes match across platforms */
+static uint64_t read64(const uint8_t *p) {
+  uint64_t x = 0;
+  for (int k = 0; k < 8; k++) x |= (uint64_t)p[k] << (k * 8);
+  return x;
+}
+
+static uint64_t hash_round(uint64_t acc, uint64_t input) {
+  acc += input * PRIME64_2;
+  acc  = rotl64(acc, 31);
+  return acc * PRIME64_1;
+}
+
+static uint64_t hash_merge(uint64_t acc, uint64_t lane) {
+  acc ^= hash_round(0, lane);
+  return acc * PRIME64_1 + PRIME64_4;
+}
+
+static uint64_t hash_avalanche(uint64_t h) {
+  h ^= h >> 33;
+  h *= PRIME64_2;
+  h ^= h >> 29;
+  h *= PRIME64_3;
+  h ^= h >> 32;
+  return h;
+}
+
+bsm_hash_t bsm_hash(const uint8_t *data, size_t n, uint64_t seed) {
+  uint64_t v[4] = {
+    seed + PRIME64_1 + PRIME64_2,
+    seed + PRIME64_2,
+    seed,
+    seed - PRIME64_1
+  };
+  
+  /* the tail is zero-padded into one last stripe -- the length is mixed in below to tell it apart */
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    for (int k = 0; k < 4; k++) v[k] = hash_round(v[k], read64(data + i + k * 8));
+  }
+  if (i < n) {
+    uint8_t stripe[32] = { 0 };
+    memcpy(stripe, data + i, n - i);
+    for (int k = 0; k < 4; k++) v[k] = hash_round(v[k], read64(stripe + k * 8));
+  }
+  
+  uint64_t lo = rotl64(v[0], 1) + rotl64(v[1], 7) + rotl64(v[2], 12) + rotl64(v[3], 18);
+  uint64_t hi = rotl64(v[3], 1) + rotl64(v[2], 7) + rotl64(v[1], 12) + rotl64(v[0], 18) + PRIME64_5;
+  for (int k = 0; k < 4; k++) {
+    lo = hash_merge(lo, v[k]);
+    hi = hash_merge(hi, v[3 - k]);
+  }
+  
+  bsm_hash_t h;
+  h.lo = hash_avalanche(lo + (uint64_t)n);
+  h.hi = hash_avalanche(hi ^ ((uint64_t)n * PRIME64_3));
+  return h;
+}
+
+static bool read_chunk(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_chunk_t chunk, void *decoded) {
+  switch (chunk) {
+    case BSM_CHUNK_POSITIONS: return bsm_read_positions(data, n, header, decoded);
+    case BSM_CHUNK_TEXCOORDS: return bsm_read_texcoords(data, n, header, decoded);
+    case BSM_CHUNK_NORMALS:   return bsm_read_normals(data, n, header, decoded);
+    case BSM_CHUNK_TANGENTS:  return bsm_read_tangents(data, n, header, decoded);
+    case BSM_CHUNK_TRIS:      return bsm_read_tris(data, n, header, decoded);
+    case BSM_CHUNK_MESHES:    return bsm_read_meshes(data, n, header, decoded);
+    case BSM_CHUNK_HULLVERTS: return bsm_read_hullverts(data, n, header, decoded);
+    case BSM_CHUNK_HULLS:     return bsm_read_hulls(data, n, header, decoded);
+    case BSM_CHUNK_VISVERTS:  return bsm_read_visverts(data, n, header, decoded);
+    case BSM_CHUNK_VISTRIS:   return bsm_read_vistris(data, n, header, decoded);
+    default:                  return false;
+  }
+}
+
+bool bsm_hash_chunks(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_hash_t *hashes) {
+  for (int c = 0; c < BSM_NUM_CHUNKS; c++) {
+    if (!bsm_chunk_fits(header, c, n)) return false;
+    hashes[c] = bsm_hash(data + bsm_chunk_offs(header, c), bsm_chunk_bytes(header, c), c + 1);
+  }
+  return true;
+}
+
+bsm_hash_t bsm_hash_model(bsm_hash_t *hashes) {
+  uint8_t buf[BSM_NUM_CHUNKS * 16];
+  for (int c = 0; c < BSM_NUM_CHUNKS; c++) {
+    for (int k = 0; k < 8; k++) {
+      buf[c * 16 + k]     = (uint8_t)(hashes[c].lo >> (k * 8));
+      buf[c * 16 + 8 + k] = (uint8_t)(hashes[c].hi >> (k * 8));
+    }
+  }
+  return bsm_hash(buf, sizeof(buf), 0);
+}
+
+static bool hash_equal(bsm_hash_t a, bsm_hash_t b) {
+  return a.lo == b.lo && a.hi == b.hi;
+}
+
+typedef struct dedup_scan {
+  bsm_dedup_file_t *files;
+  bsm_header_v1_t *headers;
+  bsm_hash_t *hashes; /* BSM_NUM_CHUNKS per file, then the model hash */
+} dedup_scan_t;
+
+static bool chunk_equal(dedup_scan_t *scan, int32_t a, int32_t b, bsm_chunk_t chunk) {
+  size_t bytes = bsm_chunk_bytes(&scan->headers[a], chunk);
+  if (bytes != bsm_chunk_bytes(&scan->headers[b], chunk)) return false;
+  return memcmp(scan->files[a].data + bsm_chunk_offs(&scan->headers[a], chunk),
+                scan->files[b].data + bsm_chunk_offs(&scan->headers[b], chunk), bytes) == 0;
+}
+
+static bool model_equal(dedup_scan_t *scan, int32_t a, int32_t b) {
+  for (int c = 0; c < BSM_NUM_CHUNKS; c++) {
+    if (!chunk_equal(scan, a, b, c)) return false;
+  }
+  return true;
+}
+
+bool bsm_dedup_scan(bsm_dedup_file_t *files, int32_t num_files, int32_t *model, int32_t *chunk, size_t *saved) {
+  int32_t stride  = BSM_NUM_CHUNKS + 1;
+  int32_t buckets = 16;
+  while (buckets < 2 * num_files) buckets *= 2;
+  
+  *saved = 0;
+  for (int32_t i = 0; i < num_files; i++) {
+    model[i] = -1;
+    for (int c = 0; c < BSM_NUM_CHUNKS; c++) chunk[i * BSM_NUM_CHUNKS + c] = -1;
+  }
+  
+  dedup_scan_t scan;
+  scan.files   = files;
+  scan.headers = malloc((num_files + 1) * sizeof(bsm_header_v1_t));
+  scan.hashes  = malloc((num_files + 1) * stride * sizeof(bsm_hash_t));
+  int32_t *table = malloc(buckets * sizeof(int32_t));
+  if (scan.headers == NULL || scan.hashes == NULL || table == NULL) {
+    free(scan.headers);
+    free(scan.hashes);
+    free(table);
+    return false;
+  }
+  
+  for (int32_t i = 0; i < num_files; i++) {
+    bsm_hash_t *hashes = &scan.hashes[i * stride];
+    if (!bsm_read_header_v1(files[i].data, files[i].n, &scan.headers[i])) continue;
+    if (!bsm_hash_chunks(files[i].data, files[i].n, &scan.headers[i], hashes)) continue;
+    hashes[BSM_NUM_CHUNKS] = bsm_hash_model(hashes);
+    model[i] = i;
+  }
+  
+  /* the model hash sits at index BSM_NUM_CHUNKS of each file's row -- one pass per chunk kind, then one for models */
+  for (int c = 0; c <= BSM_NUM_CHUNKS; c++) {
+    for (int32_t i = 0; i < buckets; i++) table[i] = -1;
+    for (int32_t i = 0; i < num_files; i++) {
+      if (model[i] < 0) continue;
+      bsm_hash_t h = scan.hashes[i * stride + c];
+      uint32_t slot = h.lo & (buckets - 1);
+      int32_t match = i;
+      for (; table[slot] >= 0; slot = (slot + 1) & (buckets - 1)) {
+        int32_t j = table[slot];
+        if (!hash_equal(scan.hashes[j * stride + c], h)) continue;
+        if (c < BSM_NUM_CHUNKS ? chunk_equal(&scan, i, j, c) : model_equal(&scan, i, j)) {
+          match = j;
+          break;
+        }
+      }
+      if (match == i) table[slot] = i;
+      if (c == BSM_NUM_CHUNKS) {
+        model[i] = match;
+      } else {
+        chunk[i * BSM_NUM_CHUNKS + c] = match;
+        if (match != i) *saved += bsm_chunk_bytes(&scan.headers[i], c);
+      }
+    }
+  }
+  
+  free(scan.headers);
+  free(scan.hashes);
+  free(table);
+  return true;
+}
+
+typedef struct registry_entry {
+  struct registry_entry *next_hash;
+  struct registry_entry *next_ptr;
+  bsm_chunk_t chunk;
+  bsm_hash_t hash;
+  size_t bytes;
+  void *decoded;
+  int32_t refs;
+} registry_entry_t;
+
+struct bsm_registry {
+  registry_entry_t **by_hash;
+  registry_entry_t **by_ptr;
+  int32_t buckets;
+  int32_t num_entries;
+  size_t bytes;
+};
+
+static uint32_t registry_ptr_slot(bsm_registry_t *registry, void *decoded) {
+  uint64_t x = (uint64_t)(uintptr_t)decoded;
+  return (uint32_t)(hash_avalanche(x) & (registry->buckets - 1));
+}
+
+static bool registry_grow(bsm_registry_t *registry) {
+  int32_t buckets = registry->buckets * 2;
+  registry_entry_t **by_hash = calloc(buckets, sizeof(registry_entry_t*));
+  registry_entry_t **by_ptr  = calloc(buckets, sizeof(registry_entry_t*));
+  if (by_hash == NULL || by_ptr == NULL) {
+    free(by_hash);
+    free(by_ptr);
+    return false;
+  }
+  
+  for (int32_t i = 0; i < registry->buckets; i++) {
+    registry_entry_t *entry = registry->by_hash[i];
+    while (entry != NULL) {
+      registry_entry_t *next = entry->next_hash;
+      uint32_t slot = entry->hash.lo & (buckets - 1);
+      entry->next_hash = by_hash[slot];
+      by_hash[slot] = entry;
+      entry = next;
+    }
+  }
+  free(registry->by_hash);
+  free(registry->by_ptr);
+  registry->by_hash = by_hash;
+  registry->by_ptr  = by_ptr;
+  registry->buckets = buckets;
+  for (int32_t i = 0; i < buckets; i++) {
+    for (registry_entry_t *entry = by_hash[i]; entry != NULL; entry = entry->next_hash) {
+      uint32_t slot = registry_ptr_slot(registry, entry->decoded);
+      entry->next_ptr = by_ptr[slot];
+      by_ptr[slot] = entry;
+    }
+  }
+  return true;
+}
+
+bsm_registry_t *bsm_registry_create(void) {
+  bsm_registry_t *registry = calloc(1, sizeof(bsm_registry_t));
+  if (registry == NULL) return NULL;
+  
+  registry->buckets = 64;
+  registry->by_hash = calloc(registry->buckets, sizeof(registry_entry_t*));
+  registry->by_ptr  = calloc(registry->buckets, sizeof(registry_entry_t*));
+  if (registry->by_hash == NULL || registry->by_ptr == NULL) {
+    bsm_registry_destroy(registry);
+    return NULL;
+  }
+  return registry;
+}
+
+void bsm_registry_destroy(bsm_registry_t *registry) {
+  if (registry == NULL) return;
+  for (int32_t i = 0; registry->by_hash != NULL && i < registry->buckets; i++) {
+    registry_entry_t *entry = registry->by_hash[i];
+    while (entry != NULL) {
+      registry_entry_t *next = entry->next_hash;
+      free(entry->decoded);
+      free(entry);
+      entry = next;
+    }
+  }
+  free(registry->by_hash);
+  free(registry->by_ptr);
+  free(registry);
+}
+
+void *bsm_registry_acquire(bsm_registry_t *registry, uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_chunk_t chunk) {
+  if (!bsm_chunk_fits(header, chunk, n)) return NULL;
+  size_t bytes = bsm_chunk_bytes(header, chunk);
+  
+  /* the encoded bytes are not kept around, so a hash match is confirmed against the decoded copy */
+  void *decoded = malloc(bytes + 1);
+  if (decoded == NULL || !read_chunk(data, n, header, chunk, decoded)) {
+    free(decoded);
+    return NULL;
+  }
+  bsm_hash_t hash = bsm_hash(data + bsm_chunk_offs(header, chunk), bytes, chunk + 1);
+  uint32_t slot = hash.lo & (registry->buckets - 1);
+  for (registry_entry_t *entry = registry->by_hash[slot]; entry != NULL; entry = entry->next_hash) {
+    if (entry->chunk != chunk || entry->bytes != bytes || !hash_equal(entry->hash, hash)) continue;
+    if (memcmp(entry->decoded, decoded, bytes) != 0) continue;
+    free(decoded);
+    entry->refs++;
+    return entry->decoded;
+  }
+  
+  registry_entry_t *entry = NULL;
+  if (registry->num_entries < registry->buckets || registry_grow(registry)) entry = calloc(1, sizeof(registry_entry_t));
+  if (entry == NULL) {
+    free(decoded);
+    return NULL;
+  }
+  entry->chunk   = chunk;
+  entry->hash    = hash;
+  entry->bytes   = bytes;
+  entry->decoded = decoded;
+  entry->refs    = 1;
+  
+  slot = hash.lo & (registry->buckets - 1);
+  entry->next_hash = registry->by_hash[slot];
+  registry->by_hash[slot] = entry;
+  slot = registry_ptr_slot(registry, decoded);
+  entry->next_ptr = registry->by_ptr[slot];
+  registry->by_ptr[slot] = entry;
+  registry->num_entries++;
+  registry->bytes += bytes;
+  return decoded;
+}
+
+void bsm_registry_release(bsm_registry_t *registry, void *decoded) {
+  if (decoded == NULL) return;
+  
+  uint32_t slot = registry_ptr_slot(registry, decoded);
+  registry_entry_t **link = &registry->by_ptr[slot];
+  while (*link != NULL && (*link)->decoded != decoded) link = &(*link)->next_ptr;
+  registry_entry_t *entry = *link;
+  if (entry == NULL || --entry->refs > 0) return;
+  
+  *link = entry->next_ptr;
+  link = &registry->by_hash[entry->hash.lo & (registry->buckets - 1)];
+  while (*link != entry) link = &(*link)->next_hash;
+  *link = entry->next_hash;
+  registry->num_entries--;
+  registry->bytes -= entry->bytes;
+  free(entry->decoded);
+  free(entry);
+}
+
+bool bsm_registry_acquire_model(bsm_registry_t *registry, uint8_t *data, size_t n, bsm_model_t *model) {
+  memset(model, 0, sizeof(bsm_model_t));
+  if (!bsm_read_header_v1(data, n, &model->header)) return false;
+  
+  bsm_header_v1_t *header = &model->header;
+  model->positions = bsm_registry_acquire(registry, data, n, header, BSM_CHUNK_POSITIONS);
+  model->texcoords = bsm_registry_acquire(registry, data, n, header, BSM_CHUNK_TEXCOORDS);
+  model->normals   = bsm_registry_acquire(registry, data, n, header, BSM_CHUNK_NORMALS);
+  model->tangents  = bsm_registry_acquire(registry, data, n, header, BSM_CHUNK_TANGENTS);
+  model->tris      = bsm_registry_acquire(registry, data, n, header, BSM_CHUNK_TRIS);
+  model->meshes    = bsm_registry_acquire(registry, data, n, header, BSM_CHUNK_MESHES);
+  model->hullverts = bsm_registry_acquire(registry, data, n, header, BSM_CHUNK_HULLVERTS);
+  model->hulls     = bsm_registry_acquire(registry, data, n, header, BSM_CHUNK_HULLS);
+  model->visverts  = bsm_registry_acquire(registry, data, n, header, BSM_CHUNK_VISVERTS);
+  model->vistris   = bsm_registry_acquire(registry, data, n, header, BSM_CHUNK_VISTRIS);
+  if (model->positions && model->texcoords && model->normals && model->tangents && model->tris &&
+      model->meshes && model->hullverts && model->hulls && model->visverts && model->vistris) return true;
+  bsm_registry_release_model(registry, model);
+  return false;
+}
+
+void bsm_registry_release_model(bsm_registry_t *registry, bsm_model_t *model) {
+  bsm_registry_release(registry, model->positions);
+  bsm_registry_release(registry, model->texcoords);
+  bsm_registry_release(registry, model->normals);
+  bsm_registry_release(registry, model->tangents);
+  bsm_registry_release(registry, model->tris);
+  bsm_registry_release(registry, model->meshes);
+  bsm_registry_release(registry, model->hullverts);
+  bsm_registry_release(registry, model->hulls);
+  bsm_registry_release(registry, model->visverts);
+  bsm_registry_release(registry, model->vistris);
+  memset(model, 0, sizeof(bsm_model_t));
+}
+
+int32_t bsm_registry_chunks(bsm_registry_t *registry) {
+  return registry->num_entries;
+}
+
+size_t bsm_registry_bytes(bsm_registry_t *registry) {
+  return registry->bytes;
+}
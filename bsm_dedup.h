@@ -0,0 +1,58 @@
+#ifndef LIBBSM_DEDUP_H
+#define LIBBSM_DEDUP_H
+
+#include "bsm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 128-bit content hash -- 'lo' alone is a usable 64-bit hash */
+typedef struct bsm_hash {
+  uint64_t lo, hi;
+} bsm_hash_t;
+
+/* hashes raw bytes in 32-byte stripes over four independent 64-bit lanes; results are the same on every host */
+bsm_hash_t bsm_hash(const uint8_t *data, size_t n, uint64_t seed);
+
+/* hashes the encoded bytes of every chunk (seeded by chunk kind), and combines them into a whole-model hash that
+ * ignores bounds and chunk placement -- two models with the same content hash alike whatever their layout */
+bool bsm_hash_chunks(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_hash_t *hashes);
+bsm_hash_t bsm_hash_model(bsm_hash_t *hashes);
+
+typedef struct bsm_dedup_file {
+  uint8_t *data;
+  size_t n;
+} bsm_dedup_file_t;
+
+/* library-wide scan: for file i, model[i] is the first file with identical content (i itself if unique, -1 if invalid)
+ * and chunk[i * BSM_NUM_CHUNKS + c] the first file whose chunk c is byte-identical (i itself if unique).
+ * matches are confirmed with a byte compare, so hash collisions cannot merge different data.  saved receives the number
+ * of encoded chunk bytes that dedup would save.  returns false if memory runs out, with every entry set to -1 */
+bool bsm_dedup_scan(bsm_dedup_file_t *files, int32_t num_files, int32_t *model, int32_t *chunk, size_t *saved);
+
+/* runtime registry handing out one shared decoded copy per distinct chunk -- shared chunks are read-only and
+ * reference-counted; the registry is not thread-safe */
+typedef struct bsm_registry bsm_registry_t;
+
+bsm_registry_t *bsm_registry_create(void);
+void bsm_registry_destroy(bsm_registry_t *registry);
+
+/* decodes the chunk and returns the registered copy instead if an identical one is held -- matches are confirmed with
+ * a byte compare of the decoded data, so hash collisions cannot share different chunks (NULL on invalid data) */
+void *bsm_registry_acquire(bsm_registry_t *registry, uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_chunk_t chunk);
+void bsm_registry_release(bsm_registry_t *registry, void *decoded);
+
+/* acquires every chunk of a model -- release with bsm_registry_release_model(), never bsm_free_model() */
+bool bsm_registry_acquire_model(bsm_registry_t *registry, uint8_t *data, size_t n, bsm_model_t *model);
+void bsm_registry_release_model(bsm_registry_t *registry, bsm_model_t *model);
+
+/* number of distinct chunks held and their decoded size */
+int32_t bsm_registry_chunks(bsm_registry_t *registry);
+size_t bsm_registry_bytes(bsm_registry_t *registry);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBBSM_DEDUP_H */
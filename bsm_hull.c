@@ -0,0 +1,605 @@
+#include "bsm_hull.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+typedef struct qh_vec {
+  double x, y, z;
+} qh_vec_t;
+
+typedef struct qh_face {
+  int32_t v[3];
+  int32_t adj[3];  /* face across the edge v[i] -> v[(i+1)%3] */
+  qh_vec_t n;
+  double d;
+  int32_t outside; /* head of the outside point list, -1 if empty */
+  int32_t mark;
+  bool alive;
+} qh_face_t;
+
+typedef struct qh {
+  qh_vec_t *pts;
+  int32_t *next;   /* outside point list links */
+  int32_t num_pts;
+  double eps;
+  int32_t mark;
+  qh_face_t *faces;
+  int32_t num_faces, cap_faces;
+  int32_t *visible;
+  int32_t num_visible, cap_visible;
+  int32_t *horizon; /* face * 3 + edge */
+  int32_t num_horizon, cap_horizon;
+} qh_t;
+
+static qh_vec_t vsub(qh_vec_t a, qh_vec_t b) {
+  return (qh_vec_t){ a.x - b.x, a.y - b.y, a.z - b.z };
+}
+
+static qh_vec_t vcross(qh_vec_t a, qh_vec_t b) {
+  return (qh_vec_t){ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+static double vdot(qh_vec_t a, qh_vec_t b) {
+  return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static double vlen(qh_vec_t a) {
+  return sqrt(vdot(a, a));
+}
+
+static bool qh_reserve(void **buf, int32_t *cap, int32_t need, size_t size) {
+  if (need <= *cap) return true;
+  int32_t n = *cap > 0 ? *cap : 16;
+  while (n < need) n *= 2;
+  void *p = realloc(*buf, n * size);
+  if (p == NULL) return false;
+  *buf = p;
+  *cap = n;
+  return true;
+}
+
+static double qh_dist(qh_t *qh, int32_t f, int32_t p) {
+  return vdot(qh->faces[f].n, qh->pts[p]) - qh->faces[f].d;
+}
+
+static int32_t qh_add_face(qh_t *qh, int32_t a, int32_t b, int32_t c) {
+  if (!qh_reserve((void**)&qh->faces, &qh->cap_faces, qh->num_faces + 1, sizeof(qh_face_t))) return -1;
+  qh_face_t *face = &qh->faces[qh->num_faces];
+  face->v[0] = a;
+  face->v[1] = b;
+  face->v[2] = c;
+  face->adj[0] = face->adj[1] = face->adj[2] = -1;
+  face->outside = -1;
+  face->mark = 0;
+  face->alive = true;
+  
+  qh_vec_t n = vcross(vsub(qh->pts[b], qh->pts[a]), vsub(qh->pts[c], qh->pts[a]));
+  double m = vlen(n);
+  if (m > 0.0) {
+    n.x /= m;
+    n.y /= m;
+    n.z /= m;
+  }
+  face->n = n;
+  face->d = vdot(n, qh->pts[a]);
+  return qh->num_faces++;
+}
+
+/* index of the edge b -> a in face f, i.e. the twin of a -> b */
+static int32_t qh_find_edge(qh_t *qh, int32_t f, int32_t a, int32_t b) {
+  qh_face_t *face = &qh->faces[f];
+  for (int i = 0; i < 3; i++) {
+    if (face->v[i] == b && face->v[(i+1)%3] == a) return i;
+  }
+  return -1;
+}
+
+/* moves p to the outside list of whichever of faces [f0, f1) it lies furthest above, or drops it as interior */
+static void qh_assign(qh_t *qh, int32_t p, int32_t f0, int32_t f1) {
+  int32_t best = -1;
+  double best_dist = qh->eps;
+  for (int32_t f = f0; f < f1; f++) {
+    double dist = qh_dist(qh, f, p);
+    if (dist > best_dist) {
+      best = f;
+      best_dist = dist;
+    }
+  }
+  if (best < 0) return;
+  qh->next[p] = qh->faces[best].outside;
+  qh->faces[best].outside = p;
+}
+
+/* depth-first walk over the faces visible from the eye point -- horizon edges are emitted in counter-clockwise order */
+static bool qh_horizon(qh_t *qh, int32_t eye, int32_t f, int32_t entered) {
+  qh->faces[f].mark = qh->mark;
+  if (!qh_reserve((void**)&qh->visible, &qh->cap_visible, qh->num_visible + 1, sizeof(int32_t))) return false;
+  qh->visible[qh->num_visible++] = f;
+  
+  int start = entered < 0 ? 0 : entered + 1;
+  int count = entered < 0 ? 3 : 2;
+  for (int k = 0; k < count; k++) {
+    int e = (start + k) % 3;
+    int32_t nb = qh->faces[f].adj[e];
+    if (qh->faces[nb].mark == qh->mark) continue;
+    if (qh_dist(qh, nb, eye) > qh->eps) {
+      int32_t j = qh_find_edge(qh, nb, qh->faces[f].v[e], qh->faces[f].v[(e+1)%3]);
+      if (j < 0) return false;
+      if (!qh_horizon(qh, eye, nb, j)) return false;
+    } else {
+      if (!qh_reserve((void**)&qh->horizon, &qh->cap_horizon, qh->num_horizon + 1, sizeof(int32_t))) return false;
+      qh->horizon[qh->num_horizon++] = f * 3 + e;
+    }
+  }
+  return true;
+}
+
+/* picks four extreme points spanning a volume -- returns false if the cloud is flat within tolerance */
+static bool qh_seed(qh_t *qh, int32_t seed[4]) {
+  qh_vec_t *pts = qh->pts;
+  int32_t extreme[6] = { 0, 0, 0, 0, 0, 0 };
+  for (int32_t i = 1; i < qh->num_pts; i++) {
+    if (pts[i].x < pts[extreme[0]].x) extreme[0] = i;
+    if (pts[i].x > pts[extreme[1]].x) extreme[1] = i;
+    if (pts[i].y < pts[extreme[2]].y) extreme[2] = i;
+    if (pts[i].y > pts[extreme[3]].y) extreme[3] = i;
+    if (pts[i].z < pts[extreme[4]].z) extreme[4] = i;
+    if (pts[i].z > pts[extreme[5]].z) extreme[5] = i;
+  }
+  
+  int32_t a = 0, b = 0, c = -1, d = -1;
+  double best = 0.0;
+  for (int i = 0; i < 6; i++) {
+    for (int j = i + 1; j < 6; j++) {
+      double dist = vlen(vsub(pts[extreme[i]], pts[extreme[j]]));
+      if (dist > best) {
+        best = dist;
+        a = extreme[i];
+        b = extreme[j];
+      }
+    }
+  }
+  if (best <= qh->eps) return false;
+  
+  qh_vec_t dir = vsub(pts[b], pts[a]);
+  best = 0.0;
+  for (int32_t i = 0; i < qh->num_pts; i++) {
+    double dist = vlen(vcross(vsub(pts[i], pts[a]), dir)) / vlen(dir);
+    if (dist > best) {
+      best = dist;
+      c = i;
+    }
+  }
+  if (best <= qh->eps) return false;
+  
+  qh_vec_t n = vcross(dir, vsub(pts[c], pts[a]));
+  double m = vlen(n);
+  n.x /= m;
+  n.y /= m;
+  n.z /= m;
+  double side = 0.0;
+  best = 0.0;
+  for (int32_t i = 0; i < qh->num_pts; i++) {
+    double dist = vdot(n, vsub(pts[i], pts[a]));
+    if (fabs(dist) > best) {
+      best = fabs(dist);
+      side = dist;
+      d = i;
+    }
+  }
+  if (best <= qh->eps) return false;
+  
+  /* wind the base so that the apex lies below it */
+  if (side > 0.0) {
+    int32_t t = b;
+    b = c;
+    c = t;
+  }
+  seed[0] = a;
+  seed[1] = b;
+  seed[2] = c;
+  seed[3] = d;
+  return true;
+}
+
+static bool qh_simplex(qh_t *qh, const int32_t seed[4]) {
+  int32_t a = seed[0], b = seed[1], c = seed[2], d = seed[3];
+  if (qh_add_face(qh, a, b, c) < 0) return false;
+  if (qh_add_face(qh, b, a, d) < 0) return false;
+  if (qh_add_face(qh, c, b, d) < 0) return false;
+  if (qh_add_face(qh, a, c, d) < 0) return false;
+  for (int32_t f = 0; f < 4; f++) {
+    for (int e = 0; e < 3; e++) {
+      for (int32_t g = 0; g < 4; g++) {
+        if (g != f && qh_find_edge(qh, g, qh->faces[f].v[e], qh->faces[f].v[(e+1)%3]) >= 0) qh->faces[f].adj[e] = g;
+      }
+    }
+  }
+  
+  for (int32_t i = 0; i < qh->num_pts; i++) {
+    if (i == a || i == b || i == c || i == d) continue;
+    qh_assign(qh, i, 0, 4);
+  }
+  return true;
+}
+
+static bool qh_build(qh_t *qh, const int32_t seed[4], int32_t max_verts) {
+  if (!qh_simplex(qh, seed)) return false;
+  
+  int32_t num_verts = 4;
+  int32_t cursor = 0;
+  while (max_verts <= 0 || num_verts < max_verts) {
+    int32_t f = -1;
+    for (int32_t i = 0; i < qh->num_faces; i++) {
+      int32_t j = (cursor + i) % qh->num_faces;
+      if (qh->faces[j].alive && qh->faces[j].outside >= 0) {
+        f = j;
+        break;
+      }
+    }
+    if (f < 0) break;
+    cursor = f;
+  
+    int32_t eye = qh->faces[f].outside;
+    for (int32_t p = qh->next[eye]; p >= 0; p = qh->next[p]) {
+      if (qh_dist(qh, f, p) > qh_dist(qh, f, eye)) eye = p;
+    }
+  
+    qh->mark++;
+    qh->num_visible = 0;
+    qh->num_horizon = 0;
+    if (!qh_horizon(qh, eye, f, -1)) return false;
+  
+    int32_t first = qh->num_faces;
+    for (int32_t i = 0; i < qh->num_horizon; i++) {
+      int32_t hf = qh->horizon[i] / 3;
+      int32_t he = qh->horizon[i] % 3;
+      int32_t a  = qh->faces[hf].v[he];
+      int32_t b  = qh->faces[hf].v[(he+1)%3];
+      int32_t nb = qh->faces[hf].adj[he];
+      int32_t nf = qh_add_face(qh, a, b, eye);
+      if (nf < 0) return false;
+  
+      int32_t j = qh_find_edge(qh, nb, a, b);
+      if (j < 0) return false;
+      qh->faces[nb].adj[j] = nf;
+      qh->faces[nf].adj[0] = nb;
+    }
+    int32_t h = qh->num_horizon;
+    for (int32_t i = 0; i < h; i++) {
+      qh->faces[first + i].adj[1] = first + (i + 1) % h;
+      qh->faces[first + i].adj[2] = first + (i + h - 1) % h;
+    }
+  
+    for (int32_t i = 0; i < qh->num_visible; i++) {
+      qh_face_t *face = &qh->faces[qh->visible[i]];
+      face->alive = false;
+      int32_t p = face->outside;
+      face->outside = -1;
+      while (p >= 0) {
+        int32_t next = qh->next[p];
+        if (p != eye) qh_assign(qh, p, first, qh->num_faces);
+        p = next;
+      }
+    }
+    num_verts++;
+  }
+  return true;
+}
+
+/* appends hull face f as a triangle of its own */
+static void qh_emit_tri(qh_t *qh, bsm_header_ext_hulls_t *header, bsm_hullface_t *hullfaces, bsm_hulledge_t *hulledges, int32_t *he_of, int32_t f) {
+  qh_face_t *face = &qh->faces[f];
+  int32_t idx_face = header->num_hullfaces++;
+  hullfaces[idx_face] = (bsm_hullface_t){ face->n.x, face->n.y, face->n.z, face->d, header->num_hulledges, 3 };
+  for (int e = 0; e < 3; e++) {
+    he_of[f*3+e] = header->num_hulledges;
+    hulledges[header->num_hulledges++] = (bsm_hulledge_t){ face->v[e], -1, idx_face };
+  }
+}
+
+/* the half-edge step places after (or before, for negative steps) half-edge i around its polygon */
+static int32_t qh_step(bsm_hullface_t *hullfaces, bsm_hulledge_t *hulledges, int32_t i, int32_t step) {
+  bsm_hullface_t *face = &hullfaces[hulledges[i].face];
+  return face->idx_edge + (i - face->idx_edge + step + face->num_edge) % face->num_edge;
+}
+
+/* drops polygon vertices that lie within tolerance of the line between the nearest corners either side, i.e. points
+ * that landed on a hull edge.  such a vertex is shared by exactly two polygons and leaves both, and the half-edges
+ * either side of it fuse into one.  vertices of a polygon that would fall below 3 edges are kept */
+static void qh_collinear(qh_t *qh, bsm_header_ext_hulls_t *header, bsm_hulltopo_t *topo, bsm_hullface_t *hullfaces, bsm_hulledge_t *hulledges, int32_t *deg, bool *drop, int32_t *remap) {
+  int32_t e0 = topo->idx_edge;
+  int32_t e1 = header->num_hulledges;
+  for (int32_t i = 0; i < qh->num_pts; i++) {
+    deg[i] = 0;
+    drop[i] = false;
+  }
+  for (int32_t i = e0; i < e1; i++) deg[hulledges[i].vert]++;
+  
+  for (int32_t i = e0; i < e1; i++) {
+    int32_t v = hulledges[i].vert;
+    if (deg[v] != 2) continue;
+    int32_t a = qh_step(hullfaces, hulledges, i, -1);
+    int32_t b = qh_step(hullfaces, hulledges, i, 1);
+    while (a != i && deg[hulledges[a].vert] == 2) a = qh_step(hullfaces, hulledges, a, -1);
+    while (b != i && deg[hulledges[b].vert] == 2) b = qh_step(hullfaces, hulledges, b, 1);
+    if (a == i || b == i) continue;
+  
+    qh_vec_t u = qh->pts[hulledges[a].vert];
+    qh_vec_t dir = vsub(qh->pts[hulledges[b].vert], u);
+    double m = vlen(dir);
+    if (m > 0.0 && vlen(vcross(vsub(qh->pts[v], u), dir)) / m <= qh->eps) drop[v] = true;
+  }
+  
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int32_t f = topo->idx_face; f < header->num_hullfaces; f++) {
+      bsm_hullface_t *face = &hullfaces[f];
+      int32_t kept = 0;
+      for (int32_t i = face->idx_edge; i < face->idx_edge + face->num_edge; i++) kept += !drop[hulledges[i].vert];
+      if (kept >= 3) continue;
+      for (int32_t i = face->idx_edge; i < face->idx_edge + face->num_edge; i++) {
+        if (drop[hulledges[i].vert]) changed = true;
+        drop[hulledges[i].vert] = false;
+      }
+    }
+  }
+  
+  /* the twin of a surviving half-edge is the surviving half-edge that starts the same fused run on the other side */
+  for (int32_t i = e0; i < e1; i++) {
+    if (drop[hulledges[i].vert]) continue;
+    int32_t t = hulledges[i].twin;
+    while (drop[hulledges[t].vert]) t = qh_step(hullfaces, hulledges, t, -1);
+    hulledges[i].twin = t;
+  }
+  
+  /* faces and their edges are laid out in order, so the survivors compact forwards in place */
+  int32_t num_edges = e0;
+  for (int32_t f = topo->idx_face; f < header->num_hullfaces; f++) {
+    bsm_hullface_t *face = &hullfaces[f];
+    int32_t idx_edge = num_edges;
+    for (int32_t i = face->idx_edge; i < face->idx_edge + face->num_edge; i++) remap[i - e0] = drop[hulledges[i].vert] ? -1 : num_edges++;
+    face->idx_edge = idx_edge;
+    face->num_edge = num_edges - idx_edge;
+  }
+  for (int32_t i = e0; i < e1; i++) {
+    if (remap[i - e0] < 0) continue;
+    bsm_hulledge_t edge = hulledges[i];
+    edge.twin = remap[edge.twin - e0];
+    hulledges[remap[i - e0]] = edge;
+  }
+  header->num_hulledges = num_edges;
+}
+
+/* converts the triangulated hull into merged polygons and appends its vertices, faces and half-edges to the output */
+static bool qh_emit(qh_t *qh, bsm_header_ext_hulls_t *header, bsm_hullvert_t *hullverts, bsm_hull_t *hull, bsm_hulltopo_t *topo, bsm_hullface_t *hullfaces, bsm_hulledge_t *hulledges) {
+  int32_t nf = qh->num_faces;
+  int32_t *local  = malloc(qh->num_pts * sizeof(int32_t));
+  int32_t *group  = malloc(nf * sizeof(int32_t));
+  int32_t *queue  = malloc(nf * sizeof(int32_t));
+  int32_t *he_of  = malloc(nf * 3 * sizeof(int32_t));
+  int32_t *deg    = malloc(qh->num_pts * sizeof(int32_t));
+  bool *drop      = malloc(qh->num_pts * sizeof(bool));
+  bool ok = local != NULL && group != NULL && queue != NULL && he_of != NULL && deg != NULL && drop != NULL;
+  
+  bsm_header_v1_t *v1 = &header->header_v1;
+  hull->idx_vert = v1->num_hullverts;
+  hull->num_vert = 0;
+  topo->idx_face = header->num_hullfaces;
+  topo->num_face = 0;
+  topo->idx_edge = header->num_hulledges;
+  topo->num_edge = 0;
+  
+  if (ok) {
+    for (int32_t i = 0; i < qh->num_pts; i++) local[i] = -1;
+    for (int32_t f = 0; f < nf; f++) {
+      group[f] = -1;
+      he_of[f*3+0] = he_of[f*3+1] = he_of[f*3+2] = -1;
+    }
+  }
+  
+  int32_t num_groups = 0;
+  for (int32_t seed = 0; ok && seed < nf; seed++) {
+    if (!qh->faces[seed].alive || group[seed] >= 0) continue;
+  
+    /* flood-fill the neighbours lying within tolerance of the seed plane */
+    int32_t g = num_groups++;
+    int32_t head = 0, tail = 0;
+    group[seed] = g;
+    queue[tail++] = seed;
+    qh_vec_t n = { 0.0, 0.0, 0.0 };
+    while (head < tail) {
+      qh_face_t *face = &qh->faces[queue[head++]];
+      qh_vec_t area = vcross(vsub(qh->pts[face->v[1]], qh->pts[face->v[0]]), vsub(qh->pts[face->v[2]], qh->pts[face->v[0]]));
+      n.x += area.x;
+      n.y += area.y;
+      n.z += area.z;
+      for (int e = 0; e < 3; e++) {
+        int32_t nb = face->adj[e];
+        if (group[nb] >= 0) continue;
+        if (vdot(qh->faces[nb].n, qh->faces[seed].n) <= 0.0) continue;
+        bool coplanar = true;
+        for (int k = 0; k < 3; k++) {
+          if (fabs(qh_dist(qh, seed, qh->faces[nb].v[k])) > qh->eps) coplanar = false;
+        }
+        if (!coplanar) continue;
+        group[nb] = g;
+        queue[tail++] = nb;
+      }
+    }
+    double m = vlen(n);
+    n.x /= m;
+    n.y /= m;
+    n.z /= m;
+  
+    /* walk the boundary of the patch, fanning around each vertex to find the next boundary edge */
+    int32_t f = -1, e = -1, boundary = 0;
+    for (int32_t i = 0; i < tail; i++) {
+      for (int k = 0; k < 3; k++) {
+        if (group[qh->faces[queue[i]].adj[k]] == g) continue;
+        boundary++;
+        if (f < 0) {
+          f = queue[i];
+          e = k;
+        }
+      }
+    }
+  
+    int32_t idx_face = header->num_hullfaces++;
+    bsm_hullface_t *out = &hullfaces[idx_face];
+    out->idx_edge = header->num_hulledges;
+    out->num_edge = 0;
+    double d = -DBL_MAX;
+    int32_t f0 = f, e0 = e;
+    while (f >= 0) {
+      int32_t v = qh->faces[f].v[e];
+      d = fmax(d, vdot(n, qh->pts[v]));
+      he_of[f*3+e] = header->num_hulledges;
+      hulledges[header->num_hulledges++] = (bsm_hulledge_t){ v, -1, idx_face };
+      out->num_edge++;
+  
+      int32_t f2 = f, e2 = (e + 1) % 3, steps = 0;
+      while (group[qh->faces[f2].adj[e2]] == g && steps++ < nf) {
+        int32_t h = qh->faces[f2].adj[e2];
+        int32_t j = qh_find_edge(qh, h, qh->faces[f2].v[e2], qh->faces[f2].v[(e2+1)%3]);
+        if (j < 0) break;
+        f2 = h;
+        e2 = (j + 1) % 3;
+      }
+      f = f2;
+      e = e2;
+      if ((f == f0 && e == e0) || out->num_edge > boundary) break;
+    }
+  
+    /* a patch with holes or a broken fan would leave boundary edges unvisited -- its triangles then go out unmerged */
+    if (out->num_edge == boundary && out->num_edge >= 3) {
+      out->x = n.x;
+      out->y = n.y;
+      out->z = n.z;
+      out->d = d;
+    } else {
+      header->num_hullfaces = idx_face;
+      header->num_hulledges = out->idx_edge;
+      for (int32_t i = 0; i < tail; i++) he_of[queue[i]*3+0] = he_of[queue[i]*3+1] = he_of[queue[i]*3+2] = -1;
+      for (int32_t i = 0; i < tail; i++) qh_emit_tri(qh, header, hullfaces, hulledges, he_of, queue[i]);
+    }
+  }
+  
+  for (int32_t f = 0; ok && f < nf; f++) {
+    if (!qh->faces[f].alive) continue;
+    for (int e = 0; e < 3; e++) {
+      int32_t he = he_of[f*3+e];
+      if (he < 0) continue;
+      int32_t nb = qh->faces[f].adj[e];
+      int32_t j  = qh_find_edge(qh, nb, qh->faces[f].v[e], qh->faces[f].v[(e+1)%3]);
+      if (j < 0 || he_of[nb*3+j] < 0) {
+        ok = false;
+        break;
+      }
+      hulledges[he].twin = he_of[nb*3+j];
+    }
+  }
+  if (ok) qh_collinear(qh, header, topo, hullfaces, hulledges, deg, drop, he_of);
+  
+  /* only vertices on a polygon boundary survive -- points left inside a merged patch are dropped with the rest */
+  for (int32_t i = topo->idx_edge; ok && i < header->num_hulledges; i++) {
+    int32_t v = hulledges[i].vert;
+    if (local[v] < 0) {
+      local[v] = hull->num_vert++;
+      hullverts[hull->idx_vert + local[v]] = (bsm_hullvert_t){ qh->pts[v].x, qh->pts[v].y, qh->pts[v].z };
+    }
+    hulledges[i].vert = hull->idx_vert + local[v];
+  }
+  
+  v1->num_hullverts += hull->num_vert;
+  topo->num_face = header->num_hullfaces - topo->idx_face;
+  topo->num_edge = header->num_hulledges - topo->idx_edge;
+  
+  free(local);
+  free(group);
+  free(queue);
+  free(he_of);
+  free(deg);
+  free(drop);
+  return ok;
+}
+
+size_t bsm_build_hullfaces_bytes(bsm_header_v1_t *header) {
+  return 2 * header->num_hullverts * sizeof(bsm_hullface_t);
+}
+
+size_t bsm_build_hulledges_bytes(bsm_header_v1_t *header) {
+  return 6 * header->num_hullverts * sizeof(bsm_hulledge_t);
+}
+
+bool bsm_build_hulls(bsm_header_ext_hulls_t *header, bsm_hullvert_t *hullverts, bsm_hull_t *hulls, float32_t tolerance, int32_t max_verts, bsm_hulltopo_t *hulltopos, bsm_hullface_t *hullfaces, bsm_hulledge_t *hulledges) {
+  bsm_header_v1_t *v1 = &header->header_v1;
+  int32_t num_hullverts = v1->num_hullverts;
+  
+  /* a hull with volume needs four vertices, so smaller limits are raised to that */
+  if (max_verts > 0 && max_verts < 4) max_verts = 4;
+  int32_t max_pts = 0;
+  for (int32_t i = 0; i < v1->num_hulls; i++) {
+    if (hulls[i].idx_vert < 0 || hulls[i].num_vert < 0) return false;
+    if (hulls[i].num_vert > num_hullverts - hulls[i].idx_vert) return false;
+    if (hulls[i].num_vert > max_pts) max_pts = hulls[i].num_vert;
+  }
+  
+  /* the cleaned hulls are built in scratch buffers and only copied over the input once every hull has succeeded */
+  qh_t qh;
+  memset(&qh, 0, sizeof(qh_t));
+  bsm_header_ext_hulls_t out = *header;
+  bsm_hullvert_t *verts = malloc(num_hullverts * sizeof(bsm_hullvert_t) + 1);
+  bsm_hull_t *out_hulls = malloc(v1->num_hulls * sizeof(bsm_hull_t) + 1);
+  qh.pts  = malloc(max_pts * sizeof(qh_vec_t) + 1);
+  qh.next = malloc(max_pts * sizeof(int32_t) + 1);
+  bool ok = verts != NULL && out_hulls != NULL && qh.pts != NULL && qh.next != NULL;
+  
+  out.header_v1.num_hullverts = 0;
+  out.num_hulltopos = v1->num_hulls;
+  out.num_hullfaces = 0;
+  out.num_hulledges = 0;
+  for (int32_t i = 0; ok && i < v1->num_hulls; i++) {
+    bsm_hull_t *hull = &out_hulls[i];
+    double extent = 0.0;
+    qh.num_pts = hulls[i].num_vert;
+    for (int32_t j = 0; j < qh.num_pts; j++) {
+      bsm_hullvert_t *p = &hullverts[hulls[i].idx_vert + j];
+      qh.pts[j]  = (qh_vec_t){ p->x, p->y, p->z };
+      qh.next[j] = -1;
+      extent = fmax(extent, fabs(p->x) + fabs(p->y) + fabs(p->z));
+    }
+    qh.eps = fmax(tolerance, 3.0 * FLT_EPSILON * extent);
+    qh.num_faces = 0;
+    qh.mark = 0;
+  
+    /* a hull without volume keeps its points as they are and gets an empty topology */
+    int32_t seed[4];
+    if (qh.num_pts < 4 || !qh_seed(&qh, seed)) {
+      hull->idx_vert = out.header_v1.num_hullverts;
+      hull->num_vert = qh.num_pts;
+      memcpy(&verts[hull->idx_vert], &hullverts[hulls[i].idx_vert], qh.num_pts * sizeof(bsm_hullvert_t));
+      out.header_v1.num_hullverts += qh.num_pts;
+      hulltopos[i] = (bsm_hulltopo_t){ out.num_hullfaces, 0, out.num_hulledges, 0 };
+      continue;
+    }
+    ok = qh_build(&qh, seed, max_verts) && qh_emit(&qh, &out, verts, hull, &hulltopos[i], hullfaces, hulledges);
+  }
+  
+  if (ok) {
+    memcpy(hullverts, verts, out.header_v1.num_hullverts * sizeof(bsm_hullvert_t));
+    memcpy(hulls, out_hulls, v1->num_hulls * sizeof(bsm_hull_t));
+    *header = out;
+  }
+  free(verts);
+  free(out_hulls);
+  free(qh.pts);
+  free(qh.next);
+  free(qh.faces);
+  free(qh.visible);
+  free(qh.horizon);
+  return ok;
+}
@@ -0,0 +1,28 @@
+#ifndef LIBBSM_HULL_H
+#define LIBBSM_HULL_H
+
+#include "bsm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* worst-case buffer sizes for bsm_build_hulls() -- the counts actually used are stored in the extension header */
+size_t bsm_build_hullfaces_bytes(bsm_header_v1_t *header);
+size_t bsm_build_hulledges_bytes(bsm_header_v1_t *header);
+
+/* runs quickhull over each hull's point cloud -- interior and near-coplanar points are dropped, within tolerance or an
+ * automatic tolerance scaled to the hull's extent, whichever is larger (so tolerance <= 0 selects the automatic one), and
+ * if max_verts > 0 each hull keeps at most max_verts of its most extreme points (values below 4 are raised to 4; the
+ * result then lies inside the full hull).  hullverts and hulls are compacted in place, the v1 header counts are updated
+ * and hulltopos/hullfaces/hulledges receive the extension chunks, with coplanar triangles merged into convex polygons and
+ * points lying on a polygon edge within tolerance dropped -- a patch that cannot be merged keeps its triangles.  a
+ * degenerate hull (flat, or fewer than 4 points) keeps its points unchanged and gets a topology without faces.  returns
+ * false if a hull is out of bounds or cannot be built, leaving header, hullverts and hulls untouched */
+bool bsm_build_hulls(bsm_header_ext_hulls_t *header, bsm_hullvert_t *hullverts, bsm_hull_t *hulls, float32_t tolerance, int32_t max_verts, bsm_hulltopo_t *hulltopos, bsm_hullface_t *hullfaces, bsm_hulledge_t *hulledges);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBBSM_HULL_H */
@@ -0,0 +1,319 @@
+#include "bsm_occluder.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+enum {
+  VOXEL_EXTERIOR = 0,
+  VOXEL_SURFACE  = 1,
+  VOXEL_INTERIOR = 2
+};
+
+typedef struct occ_box {
+  int32_t x0, y0, z0, x1, y1, z1;
+  int64_t volume;
+} occ_box_t;
+
+/* separating axis test of a triangle against an axis-aligned box (Akenine-Moller), in box-centered coordinates */
+static bool axis_test(const float *v0, const float *v1, const float *v2, const float *axis, const float *half) {
+  float p0 = v0[0] * axis[0] + v0[1] * axis[1] + v0[2] * axis[2];
+  float p1 = v1[0] * axis[0] + v1[1] * axis[1] + v1[2] * axis[2];
+  float p2 = v2[0] * axis[0] + v2[1] * axis[1] + v2[2] * axis[2];
+  float r  = half[0] * fabsf(axis[0]) + half[1] * fabsf(axis[1]) + half[2] * fabsf(axis[2]);
+  float lo = fminf(p0, fminf(p1, p2));
+  float hi = fmaxf(p0, fmaxf(p1, p2));
+  return !(lo > r || hi < -r);
+}
+
+static bool tri_box_overlap(const float *center, const float *half, const bsm_position_t *a, const bsm_position_t *b, const bsm_position_t *c) {
+  float v[3][3] = {
+    { a->x - center[0], a->y - center[1], a->z - center[2] },
+    { b->x - center[0], b->y - center[1], b->z - center[2] },
+    { c->x - center[0], c->y - center[1], c->z - center[2] }
+  };
+  float e[3][3];
+  for (int i = 0; i < 3; i++) {
+    for (int k = 0; k < 3; k++) e[i][k] = v[(i+1)%3][k] - v[i][k];
+  }
+  
+  /* the nine edge cross axis tests */
+  for (int i = 0; i < 3; i++) {
+    float axes[3][3] = {
+      { 0.0f, -e[i][2], e[i][1] },
+      { e[i][2], 0.0f, -e[i][0] },
+      { -e[i][1], e[i][0], 0.0f }
+    };
+    for (int k = 0; k < 3; k++) {
+      if (!axis_test(v[0], v[1], v[2], axes[k], half)) return false;
+    }
+  }
+  
+  /* the box face normals */
+  for (int k = 0; k < 3; k++) {
+    float lo = fminf(v[0][k], fminf(v[1][k], v[2][k]));
+    float hi = fmaxf(v[0][k], fmaxf(v[1][k], v[2][k]));
+    if (lo > half[k] || hi < -half[k]) return false;
+  }
+  
+  /* the triangle plane */
+  float n[3] = {
+    e[0][1] * e[1][2] - e[0][2] * e[1][1],
+    e[0][2] * e[1][0] - e[0][0] * e[1][2],
+    e[0][0] * e[1][1] - e[0][1] * e[1][0]
+  };
+  float d = n[0] * v[0][0] + n[1] * v[0][1] + n[2] * v[0][2];
+  float r = half[0] * fabsf(n[0]) + half[1] * fabsf(n[1]) + half[2] * fabsf(n[2]);
+  return fabsf(d) <= r;
+}
+
+static int compare_box(const void *a, const void *b) {
+  int64_t va = ((const occ_box_t*)a)->volume;
+  int64_t vb = ((const occ_box_t*)b)->volume;
+  return va < vb ? 1 : va > vb ? -1 : 0;
+}
+
+bool bsm_build_occluder(bsm_model_t *model, int32_t resolution, int32_t max_tris) {
+  bsm_header_v1_t *header = &model->header;
+  if (resolution < 1 || resolution > BSM_OCCLUDER_MAX_RESOLUTION || max_tris < 0) return false;
+  for (int32_t i = 0; i < header->num_tris; i++) {
+    for (int k = 0; k < 3; k++) {
+      if (model->tris[i].index[k] < 0 || model->tris[i].index[k] >= header->num_verts) return false;
+    }
+  }
+  
+  /* the header bounds are not trusted -- the grid is fitted to the positions actually used */
+  float lo[3] = { INFINITY, INFINITY, INFINITY };
+  float hi[3] = { -INFINITY, -INFINITY, -INFINITY };
+  for (int32_t i = 0; i < header->num_verts; i++) {
+    const float *p = &model->positions[i].x;
+    for (int k = 0; k < 3; k++) {
+      lo[k] = fminf(lo[k], p[k]);
+      hi[k] = fmaxf(hi[k], p[k]);
+    }
+  }
+  float extent = 0.0f;
+  for (int k = 0; k < 3; k++) extent = fmaxf(extent, hi[k] - lo[k]);
+  if (!isfinite(extent)) return false;
+  
+  int32_t num_boxes = 0;
+  occ_box_t *boxes = NULL;
+  float size = extent / resolution;
+  float origin[3] = { 0.0f, 0.0f, 0.0f };
+  int32_t dim[3];
+  uint8_t *grid = NULL;
+  uint8_t *covered = NULL;
+  int32_t *stack = NULL;
+  bool ok = true;
+  
+  if (header->num_tris > 0 && size > 0.0f) {
+    /* one voxel of padding all round lets the exterior flood reach everywhere outside the surface.  no axis spans
+     * more than resolution voxels (plus one for rounding), so with resolution capped the grid stays within
+     * (BSM_OCCLUDER_MAX_RESOLUTION + 4)^3 cells and every cell index fits an int32_t */
+    int64_t num_cells = 1;
+    for (int k = 0; k < 3; k++) {
+      float span = ceilf((hi[k] - lo[k]) / size);
+      if (!(span <= resolution + 1.0f)) ok = false;
+      dim[k] = ok ? (int32_t)span + 3 : 1;
+      origin[k] = lo[k] - size;
+      num_cells *= dim[k];
+    }
+    ok = ok && num_cells <= INT32_MAX;
+    size_t cells = ok ? (size_t)num_cells : 0;
+    if (ok) {
+      grid    = calloc(cells, 1);
+      covered = calloc(cells, 1);
+      stack   = malloc(cells * sizeof(int32_t));
+      ok = grid != NULL && covered != NULL && stack != NULL;
+    }
+  
+    float half[3] = { 0.5f * size, 0.5f * size, 0.5f * size };
+    for (int32_t i = 0; ok && i < header->num_tris; i++) {
+      bsm_position_t *a = &model->positions[model->tris[i].index[0]];
+      bsm_position_t *b = &model->positions[model->tris[i].index[1]];
+      bsm_position_t *c = &model->positions[model->tris[i].index[2]];
+      int32_t v0[3], v1[3];
+      for (int k = 0; k < 3; k++) {
+        float t0 = fminf((&a->x)[k], fminf((&b->x)[k], (&c->x)[k]));
+        float t1 = fmaxf((&a->x)[k], fmaxf((&b->x)[k], (&c->x)[k]));
+        v0[k] = (int32_t)floorf((t0 - origin[k]) / size) - 1;
+        v1[k] = (int32_t)floorf((t1 - origin[k]) / size) + 1;
+        if (v0[k] < 0) v0[k] = 0;
+        if (v1[k] > dim[k] - 1) v1[k] = dim[k] - 1;
+      }
+      for (int32_t z = v0[2]; z <= v1[2]; z++) {
+        for (int32_t y = v0[1]; y <= v1[1]; y++) {
+          for (int32_t x = v0[0]; x <= v1[0]; x++) {
+            size_t cell = ((size_t)z * dim[1] + y) * dim[0] + x;
+            if (grid[cell] == VOXEL_SURFACE) continue;
+            float center[3] = { origin[0] + (x + 0.5f) * size, origin[1] + (y + 0.5f) * size, origin[2] + (z + 0.5f) * size };
+            if (tri_box_overlap(center, half, a, b, c)) grid[cell] = VOXEL_SURFACE;
+          }
+        }
+      }
+    }
+  
+    /* flood the exterior from a padding corner, then everything not reached and not surface is solid */
+    int32_t top = 0;
+    if (ok) {
+      memset(covered, 0, cells);
+      stack[top++] = 0;
+      covered[0] = 1;
+    }
+    while (top > 0) {
+      int32_t cell = stack[--top];
+      int32_t x = cell % dim[0];
+      int32_t y = (cell / dim[0]) % dim[1];
+      int32_t z = cell / dim[0] / dim[1];
+      int32_t nb[6][3] = { { x-1, y, z }, { x+1, y, z }, { x, y-1, z }, { x, y+1, z }, { x, y, z-1 }, { x, y, z+1 } };
+      for (int i = 0; i < 6; i++) {
+        if (nb[i][0] < 0 || nb[i][1] < 0 || nb[i][2] < 0 || nb[i][0] >= dim[0] || nb[i][1] >= dim[1] || nb[i][2] >= dim[2]) continue;
+        int32_t next = (nb[i][2] * dim[1] + nb[i][1]) * dim[0] + nb[i][0];
+        if (covered[next] || grid[next] == VOXEL_SURFACE) continue;
+        covered[next] = 1;
+        stack[top++] = next;
+      }
+    }
+    for (size_t i = 0; ok && i < cells; i++) {
+      if (grid[i] == VOXEL_EXTERIOR && !covered[i]) grid[i] = VOXEL_INTERIOR;
+      covered[i] = 0;
+    }
+  
+    /* grow a maximal box from each solid voxel not yet covered -- boxes may overlap, which keeps them large */
+    int32_t cap_boxes = 0;
+    for (int32_t z = 0; ok && z < dim[2]; z++) {
+      for (int32_t y = 0; ok && y < dim[1]; y++) {
+        for (int32_t x = 0; ok && x < dim[0]; x++) {
+          size_t cell = ((size_t)z * dim[1] + y) * dim[0] + x;
+          if (grid[cell] != VOXEL_INTERIOR || covered[cell]) continue;
+  
+          occ_box_t box = { x, y, z, x, y, z, 0 };
+          while (box.x1 + 1 < dim[0] && grid[cell + (box.x1 + 1 - x)] == VOXEL_INTERIOR) box.x1++;
+          for (bool grow = true; grow && box.y1 + 1 < dim[1]; ) {
+            for (int32_t i = box.x0; grow && i <= box.x1; i++) {
+              grow = grid[((size_t)z * dim[1] + box.y1 + 1) * dim[0] + i] == VOXEL_INTERIOR;
+            }
+            if (grow) box.y1++;
+          }
+          for (bool grow = true; grow && box.z1 + 1 < dim[2]; ) {
+            for (int32_t j = box.y0; grow && j <= box.y1; j++) {
+              for (int32_t i = box.x0; grow && i <= box.x1; i++) {
+                grow = grid[((size_t)(box.z1 + 1) * dim[1] + j) * dim[0] + i] == VOXEL_INTERIOR;
+              }
+            }
+            if (grow) box.z1++;
+          }
+          for (int32_t k = box.z0; k <= box.z1; k++) {
+            for (int32_t j = box.y0; j <= box.y1; j++) {
+              memset(&covered[((size_t)k * dim[1] + j) * dim[0] + box.x0], 1, box.x1 - box.x0 + 1);
+            }
+          }
+          box.volume = (int64_t)(box.x1 - box.x0 + 1) * (box.y1 - box.y0 + 1) * (box.z1 - box.z0 + 1);
+  
+          if (num_boxes == cap_boxes) {
+            cap_boxes = cap_boxes > 0 ? cap_boxes * 2 : 64;
+            occ_box_t *p = realloc(boxes, cap_boxes * sizeof(occ_box_t));
+            if (p == NULL) {
+              ok = false;
+              break;
+            }
+            boxes = p;
+          }
+          boxes[num_boxes++] = box;
+        }
+      }
+    }
+  }
+  
+  free(grid);
+  free(covered);
+  free(stack);
+  
+  if (ok && num_boxes > max_tris / 12) {
+    qsort(boxes, num_boxes, sizeof(occ_box_t), compare_box);
+    num_boxes = max_tris / 12;
+  }
+  
+  bsm_visvert_t *visverts = malloc(num_boxes * 8 * sizeof(bsm_visvert_t) + 1);
+  bsm_vistri_t  *vistris  = malloc(num_boxes * 12 * sizeof(bsm_vistri_t) + 1);
+  if (!ok || visverts == NULL || vistris == NULL) {
+    free(boxes);
+    free(visverts);
+    free(vistris);
+    return false;
+  }
+  
+  /* corners are numbered by bit (1 = +x, 2 = +y, 4 = +z), faces wound counter-clockwise from outside */
+  static const int32_t quads[6][4] = {
+    { 0, 4, 6, 2 }, { 1, 3, 7, 5 },
+    { 0, 1, 5, 4 }, { 2, 6, 7, 3 },
+    { 0, 2, 3, 1 }, { 4, 5, 7, 6 }
+  };
+  for (int32_t i = 0; i < num_boxes; i++) {
+    occ_box_t *box = &boxes[i];
+    for (int32_t c = 0; c < 8; c++) {
+      bsm_visvert_t *v = &visverts[i * 8 + c];
+      v->x = origin[0] + (c & 1 ? box->x1 + 1 : box->x0) * size;
+      v->y = origin[1] + (c & 2 ? box->y1 + 1 : box->y0) * size;
+      v->z = origin[2] + (c & 4 ? box->z1 + 1 : box->z0) * size;
+    }
+    for (int f = 0; f < 6; f++) {
+      const int32_t *q = quads[f];
+      vistris[i * 12 + f * 2 + 0] = (bsm_vistri_t){ { i * 8 + q[0], i * 8 + q[1], i * 8 + q[2] } };
+      vistris[i * 12 + f * 2 + 1] = (bsm_vistri_t){ { i * 8 + q[0], i * 8 + q[2], i * 8 + q[3] } };
+    }
+  }
+  free(boxes);
+  
+  free(model->visverts);
+  free(model->vistris);
+  model->visverts = visverts;
+  model->vistris  = vistris;
+  header->num_visverts = num_boxes * 8;
+  header->num_vistris  = num_boxes * 12;
+  return true;
+}
+
+size_t bsm_append_occluder_bytes(size_t n, bsm_model_t *model) {
+  return n + bsm_visverts_bytes(&model->header) + bsm_vistris_bytes(&model->header);
+}
+
+bool bsm_append_occluder(uint8_t *data, size_t n, bsm_model_t *model, uint8_t *out, size_t out_n) {
+  bsm_header_v1_t header;
+  if (!bsm_read_header_v1(data, n, &header)) return false;
+  if (out_n < bsm_append_occluder_bytes(n, model)) return false;
+  
+  /* a 64-bit header lists the chunks twice -- both tables are re-pointed, unless the v1 one was left empty because the
+   * file outgrew 32 bits, in which case it stays empty */
+  bsm_header_ext_64_t wide;
+  bool mirror = true;
+  if (header.extension == BSM_EXT_64) {
+    if (!bsm_read_header_ext_64(data, n, &wide)) return false;
+    for (int c = 0; c < BSM_NUM_CHUNKS; c++) {
+      if (bsm_chunk_offs(&header, c) != bsm_chunk_offs_64(&wide, c) || bsm_chunk_bytes(&header, c) != bsm_chunk_bytes_64(&wide, c)) mirror = false;
+    }
+    wide.num_visverts  = model->header.num_visverts;
+    wide.offs_visverts = n;
+    wide.num_vistris   = model->header.num_vistris;
+    wide.offs_vistris  = n + bsm_visverts_bytes(&model->header);
+  }
+  
+  if (mirror) {
+    header.num_visverts  = model->header.num_visverts;
+    header.offs_visverts = n;
+    header.num_vistris   = model->header.num_vistris;
+    header.offs_vistris  = n + bsm_visverts_bytes(&header);
+    if (bsm_append_occluder_bytes(n, model) > INT32_MAX) return false;
+  }
+  
+  memcpy(out, data, n);
+  if (header.extension == BSM_EXT_64) {
+    wide.header_v1 = header;
+    return bsm_write_header_ext_64(out, out_n, &wide) &&
+      bsm_write_chunk_64(out, out_n, &wide, BSM_CHUNK_VISVERTS, model->visverts) &&
+      bsm_write_chunk_64(out, out_n, &wide, BSM_CHUNK_VISTRIS, model->vistris);
+  }
+  return bsm_write_header_v1(out, out_n, &header) &&
+    bsm_write_visverts(out, out_n, &header, model->visverts) &&
+    bsm_write_vistris(out, out_n, &header, model->vistris);
+}
@@ -0,0 +1,32 @@
+#ifndef LIBBSM_OCCLUDER_H
+#define LIBBSM_OCCLUDER_H
+
+#include "bsm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BSM_OCCLUDER_MAX_RESOLUTION 512
+
+/* builds a conservative occluder for a closed render mesh: the triangles are voxelized (resolution voxels along the
+ * longest bounding box axis, at most BSM_OCCLUDER_MAX_RESOLUTION), the solid interior is found by flooding the
+ * exterior, and the interior is covered with maximal axis-aligned boxes of which the largest are kept within max_tris
+ * (12 triangles per box).  every box lies strictly inside the render surface.  the result replaces
+ * model->visverts/vistris, which must be heap-allocated (as by bsm_read_model()).  open or very thin meshes have no
+ * interior and get an empty occluder.  returns false on invalid input (non-finite positions included) or if memory
+ * runs out */
+bool bsm_build_occluder(bsm_model_t *model, int32_t resolution, int32_t max_tris);
+
+/* copies a file and appends the occluder chunks of model to it, re-pointing the header (both chunk tables of a 64-bit
+ * offset extension header, or only the 64-bit one if the v1 view is empty) -- every other byte, including any other
+ * extension header, is left as it was.  fails if a v1 chunk table would have to reach past INT32_MAX.
+ * bsm_append_occluder_bytes() returns the size of the new file */
+size_t bsm_append_occluder_bytes(size_t n, bsm_model_t *model);
+bool bsm_append_occluder(uint8_t *data, size_t n, bsm_model_t *model, uint8_t *out, size_t out_n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBBSM_OCCLUDER_H */
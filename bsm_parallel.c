@@ -0,0 +1,63 @@
+#define _DEFAULT_SOURCE /* sysconf(_SC_NPROCESSORS_ONLN) */
+#include "bsm_parallel.h"
+
+#include <pthread.h>
+#include <unistd.h>
+
+typedef struct parallel_job {
+  pthread_mutex_t lock;
+  int32_t next;
+  int32_t num_items;
+  void (*fn)(void *arg, int32_t thread, int32_t item);
+  void *arg;
+} parallel_job_t;
+
+typedef struct parallel_worker {
+  parallel_job_t *job;
+  int32_t thread;
+  pthread_t handle;
+} parallel_worker_t;
+
+int32_t bsm_parallel_threads(int32_t num_items, int64_t work) {
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  int64_t threads = work / BSM_PARALLEL_MIN_WORK;
+  if (cpus > 0 && threads > cpus) threads = cpus;
+  if (threads > num_items) threads = num_items;
+  if (threads > BSM_PARALLEL_MAX_THREADS) threads = BSM_PARALLEL_MAX_THREADS;
+  return threads > 1 ? (int32_t)threads : 1;
+}
+
+static void *parallel_run(void *arg) {
+  parallel_worker_t *worker = arg;
+  parallel_job_t *job = worker->job;
+  for (;;) {
+    pthread_mutex_lock(&job->lock);
+    int32_t item = job->next < job->num_items ? job->next++ : -1;
+    pthread_mutex_unlock(&job->lock);
+    if (item < 0) break;
+    job->fn(job->arg, worker->thread, item);
+  }
+  return NULL;
+}
+
+void bsm_parallel_for(int32_t num_items, int32_t num_threads, void (*fn)(void *arg, int32_t thread, int32_t item), void *arg) {
+  if (num_threads > BSM_PARALLEL_MAX_THREADS) num_threads = BSM_PARALLEL_MAX_THREADS;
+  if (num_threads <= 1) {
+    for (int32_t i = 0; i < num_items; i++) fn(arg, 0, i);
+    return;
+  }
+  
+  parallel_job_t job = { PTHREAD_MUTEX_INITIALIZER, 0, num_items, fn, arg };
+  parallel_worker_t workers[BSM_PARALLEL_MAX_THREADS];
+  bool started[BSM_PARALLEL_MAX_THREADS] = { false };
+  for (int32_t t = 1; t < num_threads; t++) {
+    workers[t] = (parallel_worker_t){ &job, t };
+    started[t] = pthread_create(&workers[t].handle, NULL, parallel_run, &workers[t]) == 0;
+  }
+  workers[0] = (parallel_worker_t){ &job, 0 };
+  parallel_run(&workers[0]);
+  for (int32_t t = 1; t < num_threads; t++) {
+    if (started[t]) pthread_join(workers[t].handle, NULL);
+  }
+  pthread_mutex_destroy(&job.lock);
+}
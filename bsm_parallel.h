@@ -0,0 +1,29 @@
+#ifndef LIBBSM_PARALLEL_H
+#define LIBBSM_PARALLEL_H
+
+#include "bsm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* internal to the library -- spreads independent items (meshes, instances) over worker threads.  below this much work
+ * per thread (roughly triangles) starting a thread costs more than it saves */
+#define BSM_PARALLEL_MIN_WORK 65536
+#define BSM_PARALLEL_MAX_THREADS 64
+
+/* number of threads worth using for num_items items totalling work -- 1 for small jobs, never more than items or
+ * online processors */
+int32_t bsm_parallel_threads(int32_t num_items, int64_t work);
+
+/* calls fn(arg, thread, item) once for every item in [0, num_items), on the calling thread (thread 0) and up to
+ * num_threads - 1 workers.  items are handed out in order as threads become free, so uneven items balance out; thread
+ * is below num_threads and can index per-thread scratch.  a worker that cannot be started just leaves its share to the
+ * others, so this cannot fail */
+void bsm_parallel_for(int32_t num_items, int32_t num_threads, void (*fn)(void *arg, int32_t thread, int32_t item), void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBBSM_PARALLEL_H */
@@ -0,0 +1,288 @@
+#include "bsm_sample.h"
+#include "bsm_parallel.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* splitmix64 -- small state, and every seed (zero included) gives a good sequence */
+static uint64_t next_random(uint64_t *state) {
+  uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+/* uniform in [0, 1) from the top 24 bits */
+static float next_unit(uint64_t *state) {
+  return (float)(next_random(state) >> 40) * (1.0f / 16777216.0f);
+}
+
+static double tri_area(bsm_model_t *model, int32_t tri) {
+  bsm_position_t *a = &model->positions[model->tris[tri].index[0]];
+  bsm_position_t *b = &model->positions[model->tris[tri].index[1]];
+  bsm_position_t *c = &model->positions[model->tris[tri].index[2]];
+  double u[3] = { b->x - a->x, b->y - a->y, b->z - a->z };
+  double v[3] = { c->x - a->x, c->y - a->y, c->z - a->z };
+  double x = u[1] * v[2] - u[2] * v[1];
+  double y = u[2] * v[0] - u[0] * v[2];
+  double z = u[0] * v[1] - u[1] * v[0];
+  return 0.5 * sqrt(x * x + y * y + z * z);
+}
+
+size_t bsm_sample_areas_bytes(bsm_header_v1_t *header) {
+  return header->num_tris * sizeof(double);
+}
+
+size_t bsm_sample_table_bytes(bsm_header_v1_t *header) {
+  return header->num_tris * sizeof(bsm_alias_t);
+}
+
+/* what every thread of bsm_build_sample_table() shares -- scaled and work hold max_tris entries per thread */
+typedef struct sample_build {
+  bsm_model_t *model;
+  double *areas;
+  bsm_alias_t *table;
+  double *scaled;
+  int32_t *work;
+  int32_t max_tris;
+} sample_build_t;
+
+/* fills one mesh's running areas and alias table -- meshes are disjoint, so each can be built on its own thread */
+static void build_mesh(void *arg, int32_t thread, int32_t m) {
+  sample_build_t *build = arg;
+  bsm_model_t *model  = build->model;
+  double *areas       = build->areas;
+  bsm_alias_t *table  = build->table;
+  double *scaled      = &build->scaled[(size_t)thread * build->max_tris];
+  int32_t *work       = &build->work[(size_t)thread * build->max_tris];
+  int32_t idx = model->meshes[m].idx_tris;
+  int32_t num = model->meshes[m].num_tris;
+  double total = 0.0;
+  for (int32_t i = 0; i < num; i++) {
+    scaled[i] = tri_area(model, idx + i);
+    total += scaled[i];
+    areas[idx + i] = total;
+  }
+  if (!(total > 0.0)) return;
+  
+  /* Vose's alias method -- the small worklist grows from the front of work, the large one from the back */
+  int32_t num_small = 0, num_large = 0;
+  for (int32_t i = 0; i < num; i++) {
+    scaled[i] *= num / total;
+    if (scaled[i] < 1.0) work[num_small++] = i;
+    else work[num - 1 - num_large++] = i;
+  }
+  while (num_small > 0 && num_large > 0) {
+    int32_t s = work[--num_small];
+    int32_t l = work[num - num_large--];
+    table[idx + s] = (bsm_alias_t){ (float32_t)scaled[s], idx + l };
+    scaled[l] -= 1.0 - scaled[s];
+    if (scaled[l] < 1.0) work[num_small++] = l;
+    else work[num - 1 - num_large++] = l;
+  }
+  /* whatever is left is 1 up to rounding */
+  while (num_small > 0) {
+    int32_t s = work[--num_small];
+    table[idx + s] = (bsm_alias_t){ 1.0f, idx + s };
+  }
+  while (num_large > 0) {
+    int32_t l = work[num - num_large--];
+    table[idx + l] = (bsm_alias_t){ 1.0f, idx + l };
+  }
+}
+
+bool bsm_build_sample_table(bsm_model_t *model, double *areas, bsm_alias_t *table) {
+  bsm_header_v1_t *header = &model->header;
+  for (int32_t i = 0; i < header->num_tris; i++) {
+    for (int k = 0; k < 3; k++) {
+      if (model->tris[i].index[k] < 0 || model->tris[i].index[k] >= header->num_verts) return false;
+    }
+  }
+  int32_t max_tris = 0;
+  int64_t work = 0;
+  for (int32_t i = 0; i < header->num_meshes; i++) {
+    bsm_mesh_t *mesh = &model->meshes[i];
+    if (mesh->idx_tris < 0 || mesh->num_tris < 0 || mesh->num_tris > header->num_tris - mesh->idx_tris) return false;
+    if (mesh->num_tris > max_tris) max_tris = mesh->num_tris;
+    work += mesh->num_tris;
+  }
+  
+  /* a triangle in two meshes would get two running areas and two aliases, so overlapping meshes are rejected -- the
+   * table is borrowed to mark which mesh took each triangle */
+  for (int32_t i = 0; i < header->num_tris; i++) table[i].alias = -1;
+  for (int32_t m = 0; m < header->num_meshes; m++) {
+    for (int32_t i = 0; i < model->meshes[m].num_tris; i++) {
+      if (table[model->meshes[m].idx_tris + i].alias >= 0) return false;
+      table[model->meshes[m].idx_tris + i].alias = m;
+    }
+  }
+  
+  /* the meshes are split over threads, each with scratch for the largest mesh */
+  int32_t threads = bsm_parallel_threads(header->num_meshes, work);
+  sample_build_t build = { model, areas, table, NULL, NULL, max_tris };
+  build.scaled = malloc((size_t)threads * max_tris * sizeof(double) + 1);
+  build.work   = malloc((size_t)threads * max_tris * sizeof(int32_t) + 1);
+  if (build.scaled == NULL || build.work == NULL) {
+    free(build.scaled);
+    free(build.work);
+    return false;
+  }
+  
+  memset(areas, 0, bsm_sample_areas_bytes(header));
+  for (int32_t i = 0; i < header->num_tris; i++) table[i] = (bsm_alias_t){ 1.0f, i };
+  bsm_parallel_for(header->num_meshes, threads, build_mesh, &build);
+  
+  free(build.scaled);
+  free(build.work);
+  return true;
+}
+
+double bsm_sample_mesh_area(bsm_model_t *model, double *areas, int32_t mesh) {
+  if (mesh < 0 || mesh >= model->header.num_meshes || model->meshes[mesh].num_tris <= 0) return 0.0;
+  return areas[model->meshes[mesh].idx_tris + model->meshes[mesh].num_tris - 1];
+}
+
+static void normalize3(float32_t *v) {
+  float32_t m = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+  if (m <= 0.0f) return;
+  v[0] /= m;
+  v[1] /= m;
+  v[2] /= m;
+}
+
+static void sample_tri(bsm_model_t *model, bsm_mesh_t *mesh, bsm_alias_t *table, uint64_t *seed, bsm_sample_t *sample) {
+  /* the top 32 bits pick the triangle, the low 24 bits toss the alias coin */
+  uint64_t r = next_random(seed);
+  int32_t tri = mesh->idx_tris + (int32_t)(((r >> 32) * (uint64_t)mesh->num_tris) >> 32);
+  if ((float)(r & 0xFFFFFF) * (1.0f / 16777216.0f) >= table[tri].prob) {
+    int32_t alias = table[tri].alias;
+    if (alias >= mesh->idx_tris && alias < mesh->idx_tris + mesh->num_tris) tri = alias;
+  }
+  
+  /* uniform barycentrics by the square-root warp */
+  float32_t s = sqrtf(next_unit(seed));
+  float32_t t = next_unit(seed);
+  float32_t b[3] = { 1.0f - s, s * (1.0f - t), s * t };
+  
+  sample->tri = tri;
+  memset(&sample->position, 0, sizeof(bsm_position_t));
+  memset(&sample->normal, 0, sizeof(bsm_normal_t));
+  memset(&sample->tangent, 0, sizeof(bsm_tangent_t));
+  memset(&sample->texcoord, 0, sizeof(bsm_texcoord_t));
+  for (int k = 0; k < 3; k++) {
+    int32_t index = model->tris[tri].index[k];
+    bsm_position_t *p = &model->positions[index];
+    bsm_normal_t *n   = &model->normals[index];
+    bsm_tangent_t *g  = &model->tangents[index];
+    bsm_texcoord_t *c = &model->texcoords[index];
+    sample->bary[k] = b[k];
+    sample->position.x += b[k] * p->x;
+    sample->position.y += b[k] * p->y;
+    sample->position.z += b[k] * p->z;
+    sample->normal.x += b[k] * n->x;
+    sample->normal.y += b[k] * n->y;
+    sample->normal.z += b[k] * n->z;
+    sample->tangent.x += b[k] * g->x;
+    sample->tangent.y += b[k] * g->y;
+    sample->tangent.z += b[k] * g->z;
+    sample->tangent.handedness += b[k] * g->handedness;
+    sample->texcoord.u += b[k] * c->u;
+    sample->texcoord.v += b[k] * c->v;
+  }
+  normalize3(&sample->normal.x);
+  normalize3(&sample->tangent.x);
+  sample->tangent.handedness = sample->tangent.handedness >= 0.0f ? 1.0f : -1.0f;
+}
+
+bool bsm_sample_mesh(bsm_model_t *model, double *areas, bsm_alias_t *table, int32_t mesh, uint64_t *seed, int32_t num_samples, bsm_sample_t *samples) {
+  if (!(bsm_sample_mesh_area(model, areas, mesh) > 0.0)) return false;
+  
+  for (int32_t i = 0; i < num_samples; i++) sample_tri(model, &model->meshes[mesh], table, seed, &samples[i]);
+  return true;
+}
+
+bool bsm_sample_model(bsm_model_t *model, double *areas, bsm_alias_t *table, uint64_t *seed, int32_t num_samples, bsm_sample_t *samples) {
+  int32_t num_meshes = model->header.num_meshes;
+  double *totals = malloc(num_meshes * sizeof(double) + 1);
+  if (totals == NULL) return false;
+  
+  double total = 0.0;
+  for (int32_t i = 0; i < num_meshes; i++) {
+    total += bsm_sample_mesh_area(model, areas, i);
+    totals[i] = total;
+  }
+  if (!(total > 0.0)) {
+    free(totals);
+    return false;
+  }
+  
+  for (int32_t i = 0; i < num_samples; i++) {
+    /* first mesh whose running total exceeds the draw -- zero-area meshes are never picked */
+    double x = (double)(next_random(seed) >> 11) * (1.0 / 9007199254740992.0) * total;
+    int32_t lo = 0, hi = num_meshes - 1;
+    while (lo < hi) {
+      int32_t mid = lo + (hi - lo) / 2;
+      if (totals[mid] > x) hi = mid;
+      else lo = mid + 1;
+    }
+    sample_tri(model, &model->meshes[lo], table, seed, &samples[i]);
+  }
+  free(totals);
+  return true;
+}
+
+static uint32_t cell_slot(int64_t x, int64_t y, int64_t z, uint32_t mask) {
+  uint64_t h = (uint64_t)x * 0x9E3779B185EBCA87ULL ^ (uint64_t)y * 0xC2B2AE3D27D4EB4FULL ^ (uint64_t)z * 0x165667B19E3779F9ULL;
+  return (uint32_t)(h ^ (h >> 32)) & mask;
+}
+
+int32_t bsm_poisson_thin(bsm_sample_t *samples, int32_t num_samples, float32_t radius) {
+  if (!(radius > 0.0f)) return num_samples;
+  
+  /* kept samples are chained per grid cell of edge radius, so only the 27 cells around a sample need checking */
+  uint32_t buckets = 16;
+  while (buckets < 2 * (uint32_t)num_samples && buckets < 0x40000000) buckets *= 2;
+  int32_t *heads = malloc(buckets * sizeof(int32_t));
+  int32_t *next  = malloc(num_samples * sizeof(int32_t) + 1);
+  if (heads == NULL || next == NULL) {
+    free(heads);
+    free(next);
+    return -1;
+  }
+  for (uint32_t i = 0; i < buckets; i++) heads[i] = -1;
+  
+  float32_t r2 = radius * radius;
+  int32_t num_kept = 0;
+  for (int32_t i = 0; i < num_samples; i++) {
+    bsm_position_t *p = &samples[i].position;
+    int64_t cx = (int64_t)floorf(p->x / radius);
+    int64_t cy = (int64_t)floorf(p->y / radius);
+    int64_t cz = (int64_t)floorf(p->z / radius);
+    bool keep = true;
+    for (int dz = -1; keep && dz <= 1; dz++) {
+      for (int dy = -1; keep && dy <= 1; dy++) {
+        for (int dx = -1; keep && dx <= 1; dx++) {
+          for (int32_t j = heads[cell_slot(cx + dx, cy + dy, cz + dz, buckets - 1)]; j >= 0; j = next[j]) {
+            bsm_position_t *q = &samples[j].position;
+            float32_t x = p->x - q->x, y = p->y - q->y, z = p->z - q->z;
+            if (x * x + y * y + z * z < r2) {
+              keep = false;
+              break;
+            }
+          }
+        }
+      }
+    }
+    if (!keep) continue;
+  
+    uint32_t slot = cell_slot(cx, cy, cz, buckets - 1);
+    samples[num_kept] = samples[i];
+    next[num_kept] = heads[slot];
+    heads[slot] = num_kept++;
+  }
+  
+  free(heads);
+  free(next);
+  return num_kept;
+}
@@ -0,0 +1,53 @@
+#ifndef LIBBSM_SAMPLE_H
+#define LIBBSM_SAMPLE_H
+
+#include "bsm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* one entry of a per-mesh alias table -- triangle i is kept with probability prob, otherwise 'alias' (a triangle of the
+ * same mesh) is taken instead */
+typedef struct bsm_alias {
+  float32_t prob;
+  int32_t alias;
+} bsm_alias_t;
+
+/* a point on the render surface, with its attributes interpolated from the triangle corners */
+typedef struct bsm_sample {
+  int32_t tri;
+  float32_t bary[3];
+  bsm_position_t position;
+  bsm_normal_t normal;
+  bsm_tangent_t tangent;
+  bsm_texcoord_t texcoord;
+} bsm_sample_t;
+
+/* builds the sampling tables of every mesh: areas receives the running triangle area within each mesh (so the last
+ * entry of a mesh is its total area) and table an alias table over each mesh's triangles.  both are indexed by triangle
+ * and sized by bsm_sample_*_bytes().  meshes must cover disjoint triangle ranges.  returns false on invalid input
+ * (overlapping meshes included) or if memory runs out */
+size_t bsm_sample_areas_bytes(bsm_header_v1_t *header);
+size_t bsm_sample_table_bytes(bsm_header_v1_t *header);
+bool bsm_build_sample_table(bsm_model_t *model, double *areas, bsm_alias_t *table);
+
+/* total area of one mesh, from the tables above */
+double bsm_sample_mesh_area(bsm_model_t *model, double *areas, int32_t mesh);
+
+/* draws num_samples uniformly distributed points from one mesh, or from the whole model with meshes weighted by area.
+ * *seed is the state of the random sequence and is advanced, so batches can be drawn in turn; the tables are only read,
+ * so threads may sample concurrently with seeds of their own.  returns false if the mesh has no area */
+bool bsm_sample_mesh(bsm_model_t *model, double *areas, bsm_alias_t *table, int32_t mesh, uint64_t *seed, int32_t num_samples, bsm_sample_t *samples);
+bool bsm_sample_model(bsm_model_t *model, double *areas, bsm_alias_t *table, uint64_t *seed, int32_t num_samples, bsm_sample_t *samples);
+
+/* Poisson-disk thinning: keeps samples in order unless one already kept lies closer than radius, compacting the kept
+ * samples to the front.  thinning a dense uniform set this way gives blue-noise points -- returns the number kept, or
+ * -1 if memory runs out */
+int32_t bsm_poisson_thin(bsm_sample_t *samples, int32_t num_samples, float32_t radius);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBBSM_SAMPLE_H */
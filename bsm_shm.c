@@ -0,0 +1,718 @@
+#define _GNU_SOURCE /* memfd_create, MSG_NOSIGNAL */
+#include "bsm_shm.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+#ifdef __APPLE__
+#define st_mtim st_mtimespec
+#endif
+
+#define SHM_MAGIC 0x4D485342 /* "BSHM" */
+#define SHM_ALIGN 64
+#define SHM_MAX_LOADS 4 /* loads decoded at once -- further ones queue until a worker finishes */
+
+enum {
+  SHM_ACQUIRE = 1,
+  SHM_RELEASE = 2
+};
+
+/* messages never leave the host, so they are sent in native byte order */
+typedef struct shm_request {
+  int32_t op;
+  int32_t id;
+  char path[BSM_SHM_MAX_PATH];
+} shm_request_t;
+
+typedef struct shm_reply {
+  int32_t status;
+  int32_t id;
+  uint64_t size;
+} shm_reply_t;
+
+/* start of every segment, followed by the decoded chunks at the given offsets */
+typedef struct shm_segment {
+  uint32_t magic;
+  uint32_t reserved;
+  uint64_t size;
+  bsm_header_v1_t header;
+  uint64_t offs[BSM_NUM_CHUNKS];
+} shm_segment_t;
+
+/* a file is identified by what it is rather than by the path it was named with -- a rewritten file is a new model.
+ * fd is -1 while the model is still being loaded */
+typedef struct shm_model {
+  dev_t dev;
+  ino_t ino;
+  struct timespec mtime;
+  off_t file_size;
+  int fd;
+  size_t size;
+  int32_t id;
+  int32_t refs;
+  uint64_t used;
+} shm_model_t;
+
+/* requests are read without blocking, so a partial one waits in the connection until the rest arrives.  a connection
+ * waiting for a load is not read from until its reply has been sent */
+typedef struct shm_conn {
+  int fd;
+  int32_t waiting;
+  shm_request_t request;
+  size_t received;
+  int32_t *ids;
+  int32_t num_ids;
+  int32_t cap_ids;
+} shm_conn_t;
+
+/* a model decoded on a worker thread -- the finished job is posted back through the server's wake-up pipe.  jobs past
+ * SHM_MAX_LOADS wait in a queue linked through next */
+typedef struct shm_job {
+  struct shm_job *next;
+  pthread_t thread;
+  int file;
+  size_t file_size;
+  int32_t id;
+  int wake;
+  int fd;
+  size_t size;
+} shm_job_t;
+
+struct bsm_server {
+  int fd;
+  int wake[2];
+  int32_t num_jobs;
+  shm_job_t *queue;
+  shm_job_t *queue_tail;
+  struct sockaddr_un addr;
+  shm_model_t *models;
+  int32_t num_models;
+  int32_t cap_models;
+  shm_conn_t *conns;
+  int32_t num_conns;
+  int32_t cap_conns;
+  int32_t next_id;
+  uint64_t clock;
+  size_t budget;
+  size_t bytes;
+};
+
+typedef struct client_map {
+  uint8_t *base;
+  size_t size;
+  int32_t id;
+} client_map_t;
+
+struct bsm_client {
+  int fd;
+  client_map_t *maps;
+  int32_t num_maps;
+  int32_t cap_maps;
+};
+
+/* grows an array of *cap elements to hold at least one more */
+static bool reserve(void **array, int32_t *cap, int32_t num, size_t size) {
+  if (num < *cap) return true;
+  
+  int32_t grown = *cap > 0 ? *cap * 2 : 16;
+  void *p = realloc(*array, grown * size);
+  if (p == NULL) return false;
+  *array = p;
+  *cap = grown;
+  return true;
+}
+
+static size_t align_up(size_t x) {
+  return (x + SHM_ALIGN - 1) & ~(size_t)(SHM_ALIGN - 1);
+}
+
+static void *model_chunk(bsm_model_t *model, bsm_chunk_t chunk) {
+  switch (chunk) {
+    case BSM_CHUNK_POSITIONS: return model->positions;
+    case BSM_CHUNK_TEXCOORDS: return model->texcoords;
+    case BSM_CHUNK_NORMALS:   return model->normals;
+    case BSM_CHUNK_TANGENTS:  return model->tangents;
+    case BSM_CHUNK_TRIS:      return model->tris;
+    case BSM_CHUNK_MESHES:    return model->meshes;
+    case BSM_CHUNK_HULLVERTS: return model->hullverts;
+    case BSM_CHUNK_HULLS:     return model->hulls;
+    case BSM_CHUNK_VISVERTS:  return model->visverts;
+    case BSM_CHUNK_VISTRIS:   return model->vistris;
+    default:                  return NULL;
+  }
+}
+
+static void set_model_chunk(bsm_model_t *model, bsm_chunk_t chunk, void *p) {
+  switch (chunk) {
+    case BSM_CHUNK_POSITIONS: model->positions = p; break;
+    case BSM_CHUNK_TEXCOORDS: model->texcoords = p; break;
+    case BSM_CHUNK_NORMALS:   model->normals   = p; break;
+    case BSM_CHUNK_TANGENTS:  model->tangents  = p; break;
+    case BSM_CHUNK_TRIS:      model->tris      = p; break;
+    case BSM_CHUNK_MESHES:    model->meshes    = p; break;
+    case BSM_CHUNK_HULLVERTS: model->hullverts = p; break;
+    case BSM_CHUNK_HULLS:     model->hulls     = p; break;
+    case BSM_CHUNK_VISVERTS:  model->visverts  = p; break;
+    case BSM_CHUNK_VISTRIS:   model->vistris   = p; break;
+    default:                  break;
+  }
+}
+
+static int create_shared(size_t size) {
+#ifdef __linux__
+  int fd = memfd_create("bsm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+#else
+  /* no anonymous shared memory -- a uniquely named object is unlinked as soon as it exists */
+  static int counter = 0;
+  char name[64];
+  snprintf(name, sizeof(name), "/bsm-%ld-%d", (long)getpid(), counter++);
+  int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd >= 0) shm_unlink(name);
+#endif
+  if (fd < 0) return -1;
+  if (ftruncate(fd, size) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/* decodes an open model file of n bytes into a new shared segment -- returns its descriptor, or -1 */
+static int load_segment(int file, size_t n, size_t *size) {
+  uint8_t *data = n > 0 ? mmap(NULL, n, PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+  if (data == MAP_FAILED) return -1;
+  
+  bsm_model_t model;
+  bool ok = bsm_read_model(data, n, &model);
+  munmap(data, n);
+  if (!ok) return -1;
+  
+  shm_segment_t segment;
+  memset(&segment, 0, sizeof(segment));
+  segment.magic  = SHM_MAGIC;
+  segment.header = model.header;
+  size_t offs = align_up(sizeof(shm_segment_t));
+  for (int c = 0; c < BSM_NUM_CHUNKS; c++) {
+    segment.offs[c] = offs;
+    offs = align_up(offs + bsm_chunk_bytes(&model.header, c));
+  }
+  segment.size = offs;
+  
+  int fd = create_shared(offs);
+  uint8_t *base = fd < 0 ? MAP_FAILED : mmap(NULL, offs, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED) {
+    if (fd >= 0) close(fd);
+    bsm_free_model(&model);
+    return -1;
+  }
+  memcpy(base, &segment, sizeof(segment));
+  for (int c = 0; c < BSM_NUM_CHUNKS; c++) {
+    memcpy(base + segment.offs[c], model_chunk(&model, c), bsm_chunk_bytes(&model.header, c));
+  }
+  munmap(base, offs);
+  bsm_free_model(&model);
+#ifdef __linux__
+  /* clients map read-only, but sealing also keeps anyone from resizing the segment under them */
+  if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) != 0) {
+    close(fd);
+    return -1;
+  }
+#endif
+
+  *size = offs;
+  return fd;
+}
+
+static void *load_worker(void *arg) {
+  shm_job_t *job = arg;
+  job->fd = load_segment(job->file, job->file_size, &job->size);
+  close(job->file);
+  
+  /* a pointer is well below PIPE_BUF, so the write is atomic */
+  while (write(job->wake, &job, sizeof(job)) < 0 && errno == EINTR);
+  return NULL;
+}
+
+/* collects a finished load, or returns NULL if none is ready */
+static shm_job_t *take_job(bsm_server_t *server) {
+  shm_job_t *job;
+  if (read(server->wake[0], &job, sizeof(job)) != (ssize_t)sizeof(job)) return NULL;
+  pthread_join(job->thread, NULL);
+  server->num_jobs--;
+  return job;
+}
+
+static int32_t find_model(bsm_server_t *server, int32_t id) {
+  for (int32_t i = 0; i < server->num_models; i++) {
+    if (server->models[i].id == id) return i;
+  }
+  return -1;
+}
+
+/* drops unreferenced models, least recently used first, until the server is within budget */
+static void evict(bsm_server_t *server) {
+  while (server->bytes > server->budget) {
+    int32_t lru = -1;
+    for (int32_t i = 0; i < server->num_models; i++) {
+      shm_model_t *model = &server->models[i];
+      if (model->refs == 0 && model->fd >= 0 && (lru < 0 || model->used < server->models[lru].used)) lru = i;
+    }
+    if (lru < 0) return;
+  
+    shm_model_t *model = &server->models[lru];
+    close(model->fd);
+    server->bytes -= model->size;
+    *model = server->models[--server->num_models];
+  }
+}
+
+static void unref(bsm_server_t *server, int32_t id) {
+  int32_t i = find_model(server, id);
+  if (i >= 0) server->models[i].refs--;
+}
+
+static bool send_reply(int fd, shm_reply_t *reply, int shared) {
+  struct iovec iov;
+  iov.iov_base = reply;
+  iov.iov_len  = sizeof(shm_reply_t);
+  union {
+    struct cmsghdr align;
+    char buf[CMSG_SPACE(sizeof(int))];
+  } control;
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov    = &iov;
+  msg.msg_iovlen = 1;
+  if (shared >= 0) {
+    memset(&control, 0, sizeof(control));
+    msg.msg_control    = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type  = SCM_RIGHTS;
+    cmsg->cmsg_len   = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &shared, sizeof(int));
+  }
+  return sendmsg(fd, &msg, MSG_NOSIGNAL) == (ssize_t)sizeof(shm_reply_t);
+}
+
+/* replies to an acquire with the model's segment, or with a failure if model is NULL */
+static bool grant(bsm_server_t *server, shm_conn_t *conn, shm_model_t *model) {
+  shm_reply_t reply = { -1, -1, 0 };
+  if (model != NULL && reserve((void**)&conn->ids, &conn->cap_ids, conn->num_ids, sizeof(int32_t))) {
+    model->refs++;
+    model->used = ++server->clock;
+    conn->ids[conn->num_ids++] = model->id;
+    reply.status = 0;
+    reply.id     = model->id;
+    reply.size   = model->size;
+  }
+  bool sent = send_reply(conn->fd, &reply, reply.status == 0 ? model->fd : -1);
+  evict(server);
+  return sent;
+}
+
+/* serves a resident model at once and starts a load on a worker thread otherwise -- the connection then waits for it */
+static bool acquire(bsm_server_t *server, shm_conn_t *conn, const char *path) {
+  /* a relative path would be resolved against the server's working directory, not the client's */
+  if (path[0] != '/') return grant(server, conn, NULL);
+  
+  struct stat st;
+  int file = open(path, O_RDONLY | O_CLOEXEC);
+  if (file < 0) return grant(server, conn, NULL);
+  if (fstat(file, &st) != 0 || !S_ISREG(st.st_mode) || (uint64_t)st.st_size > SIZE_MAX) {
+    close(file);
+    return grant(server, conn, NULL);
+  }
+  
+  for (int32_t i = 0; i < server->num_models; i++) {
+    shm_model_t *model = &server->models[i];
+    if (model->dev != st.st_dev || model->ino != st.st_ino || model->file_size != st.st_size) continue;
+    if (model->mtime.tv_sec != st.st_mtim.tv_sec || model->mtime.tv_nsec != st.st_mtim.tv_nsec) continue;
+    close(file);
+    if (model->fd >= 0) return grant(server, conn, model);
+    conn->waiting = model->id;
+    return true;
+  }
+  
+  shm_job_t *job = calloc(1, sizeof(shm_job_t));
+  if (job == NULL || !reserve((void**)&server->models, &server->cap_models, server->num_models, sizeof(shm_model_t))) {
+    free(job);
+    close(file);
+    return grant(server, conn, NULL);
+  }
+  job->file      = file;
+  job->file_size = st.st_size;
+  job->id        = server->next_id++;
+  job->wake      = server->wake[1];
+  if (server->num_jobs < SHM_MAX_LOADS) {
+    if (pthread_create(&job->thread, NULL, load_worker, job) != 0) {
+      free(job);
+      close(file);
+      return grant(server, conn, NULL);
+    }
+    server->num_jobs++;
+  } else {
+    if (server->queue == NULL) server->queue = job;
+    else server->queue_tail->next = job;
+    server->queue_tail = job;
+  }
+  
+  shm_model_t *model = &server->models[server->num_models++];
+  memset(model, 0, sizeof(shm_model_t));
+  model->dev       = st.st_dev;
+  model->ino       = st.st_ino;
+  model->mtime     = st.st_mtim;
+  model->file_size = st.st_size;
+  model->fd        = -1;
+  model->id        = job->id;
+  conn->waiting = model->id;
+  return true;
+}
+
+static void release(bsm_server_t *server, shm_conn_t *conn, int32_t id) {
+  for (int32_t i = 0; i < conn->num_ids; i++) {
+    if (conn->ids[i] != id) continue;
+    conn->ids[i] = conn->ids[--conn->num_ids];
+    unref(server, id);
+    evict(server);
+    return;
+  }
+}
+
+static void drop_conn(bsm_server_t *server, int32_t index) {
+  shm_conn_t *conn = &server->conns[index];
+  for (int32_t i = 0; i < conn->num_ids; i++) unref(server, conn->ids[i]);
+  close(conn->fd);
+  free(conn->ids);
+  *conn = server->conns[--server->num_conns];
+  evict(server);
+}
+
+/* handles whatever requests have fully arrived -- false once the client has gone or misbehaved */
+static bool serve(bsm_server_t *server, shm_conn_t *conn) {
+  while (conn->waiting < 0) {
+    uint8_t *buf = (uint8_t*)&conn->request;
+    ssize_t got = recv(conn->fd, buf + conn->received, sizeof(shm_request_t) - conn->received, 0);
+    if (got < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    if (got == 0) return false;
+    conn->received += got;
+    if (conn->received < sizeof(shm_request_t)) continue;
+  
+    shm_request_t *request = &conn->request;
+    request->path[BSM_SHM_MAX_PATH - 1] = '\0';
+    conn->received = 0;
+    switch (request->op) {
+      case SHM_ACQUIRE: if (!acquire(server, conn, request->path)) return false; break;
+      case SHM_RELEASE: release(server, conn, request->id); break;
+      default:          return false;
+    }
+  }
+  return true;
+}
+
+/* registers a finished load and answers every connection waiting for it */
+static void finish(bsm_server_t *server, shm_job_t *job) {
+  int32_t i = find_model(server, job->id);
+  if (job->fd >= 0) {
+    server->models[i].fd   = job->fd;
+    server->models[i].size = job->size;
+    server->bytes += job->size;
+  } else {
+    server->models[i] = server->models[--server->num_models];
+  }
+  
+  /* replies may evict other models and move this one, so it is looked up again for each */
+  for (int32_t c = server->num_conns - 1; c >= 0; c--) {
+    shm_conn_t *conn = &server->conns[c];
+    if (conn->waiting != job->id) continue;
+    conn->waiting = -1;
+    i = find_model(server, job->id);
+    if (!grant(server, conn, i >= 0 ? &server->models[i] : NULL)) drop_conn(server, c);
+  }
+  free(job);
+  evict(server);
+}
+
+/* starts queued loads while workers are free -- a load that cannot be started fails like one that could not be read */
+static void start_queued(bsm_server_t *server) {
+  while (server->queue != NULL && server->num_jobs < SHM_MAX_LOADS) {
+    shm_job_t *job = server->queue;
+    server->queue = job->next;
+    if (pthread_create(&job->thread, NULL, load_worker, job) != 0) {
+      close(job->file);
+      job->fd = -1;
+      finish(server, job);
+      continue;
+    }
+    server->num_jobs++;
+  }
+}
+
+static bool set_flags(int fd, int fd_flags, int fl_flags) {
+  return fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) | fd_flags) == 0 && fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | fl_flags) == 0;
+}
+
+bsm_server_t *bsm_server_create(const char *socket_path, size_t budget) {
+  bsm_server_t *server = calloc(1, sizeof(bsm_server_t));
+  if (server == NULL) return NULL;
+  
+  server->budget = budget;
+  server->addr.sun_family = AF_UNIX;
+  if (strlen(socket_path) >= sizeof(server->addr.sun_path)) {
+    free(server);
+    return NULL;
+  }
+  strcpy(server->addr.sun_path, socket_path);
+  
+  server->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (server->fd < 0) {
+    free(server);
+    return NULL;
+  }
+  if (pipe(server->wake) != 0) {
+    close(server->fd);
+    free(server);
+    return NULL;
+  }
+  if (!set_flags(server->wake[0], FD_CLOEXEC, O_NONBLOCK) || !set_flags(server->wake[1], FD_CLOEXEC, 0)) {
+    close(server->wake[0]);
+    close(server->wake[1]);
+    close(server->fd);
+    free(server);
+    return NULL;
+  }
+  /* nobody can connect before listen(), so the socket is owner-only from the start */
+  unlink(socket_path);
+  if (bind(server->fd, (struct sockaddr*)&server->addr, sizeof(server->addr)) != 0 || chmod(socket_path, 0600) != 0 ||
+      listen(server->fd, 64) != 0) {
+    close(server->wake[0]);
+    close(server->wake[1]);
+    close(server->fd);
+    free(server);
+    return NULL;
+  }
+  return server;
+}
+
+void bsm_server_destroy(bsm_server_t *server) {
+  if (server == NULL) return;
+  
+  /* loads still in flight write to the wake-up pipe when done */
+  while (server->num_jobs > 0) {
+    struct pollfd wake = { server->wake[0], POLLIN, 0 };
+    if (poll(&wake, 1, -1) < 0 && errno != EINTR) break;
+    for (shm_job_t *job = take_job(server); job != NULL; job = take_job(server)) {
+      if (job->fd >= 0) close(job->fd);
+      free(job);
+    }
+  }
+  while (server->queue != NULL) {
+    shm_job_t *job = server->queue;
+    server->queue = job->next;
+    close(job->file);
+    free(job);
+  }
+  for (int32_t i = 0; i < server->num_conns; i++) {
+    close(server->conns[i].fd);
+    free(server->conns[i].ids);
+  }
+  for (int32_t i = 0; i < server->num_models; i++) {
+    if (server->models[i].fd >= 0) close(server->models[i].fd);
+  }
+  close(server->wake[0]);
+  close(server->wake[1]);
+  close(server->fd);
+  unlink(server->addr.sun_path);
+  free(server->conns);
+  free(server->models);
+  free(server);
+}
+
+bool bsm_server_poll(bsm_server_t *server, int timeout_ms) {
+  int32_t num = server->num_conns;
+  struct pollfd *fds = malloc((num + 2) * sizeof(struct pollfd));
+  if (fds == NULL) return false;
+  
+  fds[0].fd = server->fd;
+  fds[0].events = POLLIN;
+  fds[1].fd = server->wake[0];
+  fds[1].events = POLLIN;
+  for (int32_t i = 0; i < num; i++) {
+    fds[i + 2].fd = server->conns[i].fd;
+    fds[i + 2].events = server->conns[i].waiting < 0 ? POLLIN : 0;
+  }
+  if (poll(fds, num + 2, timeout_ms) < 0) {
+    free(fds);
+    return errno == EINTR;
+  }
+  
+  /* backwards, since dropping a connection moves the last one into its slot */
+  for (int32_t i = num - 1; i >= 0; i--) {
+    short revents = fds[i + 2].revents;
+    if (revents == 0) continue;
+    if (server->conns[i].waiting >= 0 ? (revents & (POLLHUP | POLLERR)) != 0 : !serve(server, &server->conns[i])) {
+      drop_conn(server, i);
+    }
+  }
+  if (fds[1].revents & POLLIN) {
+    for (shm_job_t *job = take_job(server); job != NULL; job = take_job(server)) finish(server, job);
+    start_queued(server);
+  }
+  if (fds[0].revents & POLLIN) {
+    int fd = accept(server->fd, NULL, NULL);
+    if (fd >= 0 && set_flags(fd, FD_CLOEXEC, O_NONBLOCK) &&
+        reserve((void**)&server->conns, &server->cap_conns, server->num_conns, sizeof(shm_conn_t))) {
+      shm_conn_t *conn = &server->conns[server->num_conns++];
+      memset(conn, 0, sizeof(shm_conn_t));
+      conn->fd = fd;
+      conn->waiting = -1;
+    } else if (fd >= 0) {
+      close(fd);
+    }
+  }
+  free(fds);
+  return true;
+}
+
+int32_t bsm_server_models(bsm_server_t *server) {
+  return server->num_models;
+}
+
+size_t bsm_server_bytes(bsm_server_t *server) {
+  return server->bytes;
+}
+
+bsm_client_t *bsm_client_connect(const char *socket_path) {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(socket_path) >= sizeof(addr.sun_path)) return NULL;
+  strcpy(addr.sun_path, socket_path);
+  
+  bsm_client_t *client = calloc(1, sizeof(bsm_client_t));
+  if (client == NULL) return NULL;
+  client->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (client->fd < 0 || connect(client->fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+    if (client->fd >= 0) close(client->fd);
+    free(client);
+    return NULL;
+  }
+  return client;
+}
+
+void bsm_client_disconnect(bsm_client_t *client) {
+  if (client == NULL) return;
+  
+  for (int32_t i = 0; i < client->num_maps; i++) munmap(client->maps[i].base, client->maps[i].size);
+  close(client->fd);
+  free(client->maps);
+  free(client);
+}
+
+static bool send_request(bsm_client_t *client, int32_t op, int32_t id, const char *path) {
+  shm_request_t request;
+  memset(&request, 0, sizeof(request));
+  request.op = op;
+  request.id = id;
+  if (path != NULL) strncpy(request.path, path, BSM_SHM_MAX_PATH - 1);
+  return send(client->fd, &request, sizeof(request), MSG_NOSIGNAL) == (ssize_t)sizeof(request);
+}
+
+/* a segment from the server is still checked, so a broken server cannot send clients out of bounds */
+static bool segment_valid(uint8_t *base, size_t size) {
+  if (size < sizeof(shm_segment_t)) return false;
+  
+  shm_segment_t *segment = (shm_segment_t*)base;
+  bsm_header_v1_t *header = &segment->header;
+  if (segment->magic != SHM_MAGIC || segment->size != size) return false;
+  if (header->num_verts < 0 || header->num_tris < 0 || header->num_meshes < 0 || header->num_hullverts < 0 ||
+      header->num_hulls < 0 || header->num_visverts < 0 || header->num_vistris < 0) return false;
+  for (int c = 0; c < BSM_NUM_CHUNKS; c++) {
+    uint64_t offs  = segment->offs[c];
+    uint64_t bytes = bsm_chunk_bytes(header, c);
+    if (offs % SHM_ALIGN != 0 || offs > size || bytes > size - offs) return false;
+  }
+  return true;
+}
+
+bool bsm_client_acquire(bsm_client_t *client, const char *path, bsm_model_t *model) {
+  /* the server only takes absolute paths, since it does not share our working directory */
+  char *resolved = realpath(path, NULL);
+  if (resolved == NULL) return false;
+  bool sent = strlen(resolved) < BSM_SHM_MAX_PATH &&
+    reserve((void**)&client->maps, &client->cap_maps, client->num_maps, sizeof(client_map_t)) &&
+    send_request(client, SHM_ACQUIRE, -1, resolved);
+  free(resolved);
+  if (!sent) return false;
+  
+  shm_reply_t reply;
+  struct iovec iov;
+  iov.iov_base = &reply;
+  iov.iov_len  = sizeof(reply);
+  union {
+    struct cmsghdr align;
+    char buf[CMSG_SPACE(sizeof(int))];
+  } control;
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov        = &iov;
+  msg.msg_iovlen     = 1;
+  msg.msg_control    = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+  if (recvmsg(client->fd, &msg, MSG_WAITALL) != (ssize_t)sizeof(reply)) return false;
+  
+  int fd = -1;
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  if (cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+    memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+  }
+  if (reply.status != 0 || fd < 0 || reply.size > SIZE_MAX) {
+    if (fd >= 0) close(fd);
+    if (reply.status == 0) send_request(client, SHM_RELEASE, reply.id, NULL);
+    return false;
+  }
+  
+  /* the mapping outlives the descriptor */
+  size_t size = reply.size;
+  uint8_t *base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED || !segment_valid(base, size)) {
+    if (base != MAP_FAILED) munmap(base, size);
+    send_request(client, SHM_RELEASE, reply.id, NULL);
+    return false;
+  }
+  
+  shm_segment_t *segment = (shm_segment_t*)base;
+  model->header = segment->header;
+  for (int c = 0; c < BSM_NUM_CHUNKS; c++) set_model_chunk(model, c, base + segment->offs[c]);
+  client->maps[client->num_maps++] = (client_map_t){ base, size, reply.id };
+  return true;
+}
+
+void bsm_client_release(bsm_client_t *client, bsm_model_t *model) {
+  uint8_t *p = (uint8_t*)model->positions;
+  for (int32_t i = 0; i < client->num_maps; i++) {
+    client_map_t *map = &client->maps[i];
+    if (p < map->base || p >= map->base + map->size) continue;
+  
+    munmap(map->base, map->size);
+    send_request(client, SHM_RELEASE, map->id, NULL);
+    *map = client->maps[--client->num_maps];
+    break;
+  }
+  for (int c = 0; c < BSM_NUM_CHUNKS; c++) set_model_chunk(model, c, NULL);
+}
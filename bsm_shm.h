@@ -0,0 +1,50 @@
+#ifndef LIBBSM_SHM_H
+#define LIBBSM_SHM_H
+
+#include "bsm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* shared-memory model server (POSIX) -- a local server decodes each model file once into a shared memory segment and
+ * hands its descriptor to clients over a Unix socket.  clients map the segment read-only and get an ordinary
+ * bsm_model_t pointing into it, so every process on the host shares one decoded copy */
+
+#define BSM_SHM_MAX_PATH 1024
+
+typedef struct bsm_server bsm_server_t;
+typedef struct bsm_client bsm_client_t;
+
+/* listens on socket_path (replacing a stale socket file), which is created with mode 0600 so only processes of the same
+ * user can connect -- chmod it afterwards to share the server wider.  models are decoded on a few worker threads, so a
+ * slow load never holds up other clients, and loads past that wait their turn.  a file is recognized by device, inode,
+ * modification time and size rather than by path.
+ * decoded models nobody holds are kept for reuse, least recently used first out, while the server holds more than
+ * budget bytes -- models in use are never evicted */
+bsm_server_t *bsm_server_create(const char *socket_path, size_t budget);
+void bsm_server_destroy(bsm_server_t *server);
+
+/* serves pending connections, requests and finished loads, waiting up to timeout_ms (-1 = forever) for the first --
+ * returns false if polling fails.  a client's references are dropped when it disconnects, so a crashed worker cannot
+ * pin a model */
+bool bsm_server_poll(bsm_server_t *server, int timeout_ms);
+
+/* number of resident models and their segment size */
+int32_t bsm_server_models(bsm_server_t *server);
+size_t bsm_server_bytes(bsm_server_t *server);
+
+bsm_client_t *bsm_client_connect(const char *socket_path);
+void bsm_client_disconnect(bsm_client_t *client);
+
+/* maps the model stored at path, which is resolved to an absolute path here since the server rejects relative ones --
+ * the chunks are read-only and must be released with bsm_client_release(), never bsm_free_model().  returns false if
+ * the server cannot load the file or is gone */
+bool bsm_client_acquire(bsm_client_t *client, const char *path, bsm_model_t *model);
+void bsm_client_release(bsm_client_t *client, bsm_model_t *model);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBBSM_SHM_H */
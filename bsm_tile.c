@@ -0,0 +1,270 @@
+#include "bsm_tile.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* deep enough for any sane max_tris; stops the split when many centroids coincide */
+#define TILE_MAX_DEPTH 20
+
+typedef struct tile_tri {
+  int32_t mesh;
+  int32_t tri;
+} tile_tri_t;
+
+typedef struct tile_leaf {
+  int32_t idx;
+  int32_t num;
+} tile_leaf_t;
+
+typedef struct tile_ctx {
+  float *centroids;
+  tile_tri_t *order;
+  tile_tri_t *scratch;
+  tile_leaf_t *leaves;
+  int32_t num_leaves;
+  int32_t cap_leaves;
+  int32_t max_tris;
+} tile_ctx_t;
+
+/* triangles outside every mesh sort after those of the last mesh */
+static int compare_tri(const void *a, const void *b) {
+  const tile_tri_t *x = a, *y = b;
+  uint32_t mx = (uint32_t)x->mesh, my = (uint32_t)y->mesh;
+  if (mx != my) return mx < my ? -1 : 1;
+  return (x->tri > y->tri) - (x->tri < y->tri);
+}
+
+static bool tile_split(tile_ctx_t *ctx, int32_t idx, int32_t num, const float *lo, const float *hi, int depth) {
+  if (num <= ctx->max_tris || depth == TILE_MAX_DEPTH) {
+    if (ctx->num_leaves == ctx->cap_leaves) {
+      int32_t cap = ctx->cap_leaves > 0 ? ctx->cap_leaves * 2 : 64;
+      tile_leaf_t *leaves = realloc(ctx->leaves, cap * sizeof(tile_leaf_t));
+      if (leaves == NULL) return false;
+      ctx->leaves = leaves;
+      ctx->cap_leaves = cap;
+    }
+    ctx->leaves[ctx->num_leaves++] = (tile_leaf_t){ idx, num };
+    return true;
+  }
+  
+  float mid[3];
+  for (int k = 0; k < 3; k++) mid[k] = 0.5f * (lo[k] + hi[k]);
+  
+  /* counting sort of the node's triangles into octants, numbered by bit (1 = +x, 2 = +y, 4 = +z) */
+  int32_t count[8] = { 0 };
+  int32_t start[8];
+  for (int32_t i = idx; i < idx + num; i++) {
+    const float *c = &ctx->centroids[ctx->order[i].tri * 3];
+    count[(c[0] > mid[0]) | (c[1] > mid[1]) << 1 | (c[2] > mid[2]) << 2]++;
+  }
+  start[0] = idx;
+  for (int o = 1; o < 8; o++) start[o] = start[o-1] + count[o-1];
+  for (int32_t i = idx; i < idx + num; i++) {
+    const float *c = &ctx->centroids[ctx->order[i].tri * 3];
+    ctx->scratch[start[(c[0] > mid[0]) | (c[1] > mid[1]) << 1 | (c[2] > mid[2]) << 2]++] = ctx->order[i];
+  }
+  memcpy(&ctx->order[idx], &ctx->scratch[idx], num * sizeof(tile_tri_t));
+  
+  int32_t child = idx;
+  for (int o = 0; o < 8; o++) {
+    float clo[3], chi[3];
+    for (int k = 0; k < 3; k++) {
+      clo[k] = o & (1 << k) ? mid[k] : lo[k];
+      chi[k] = o & (1 << k) ? hi[k] : mid[k];
+    }
+    if (count[o] > 0 && !tile_split(ctx, child, count[o], clo, chi, depth + 1)) return false;
+    child += count[o];
+  }
+  return true;
+}
+
+bool bsm_build_tiles(bsm_model_t *model, int32_t max_tris, bsm_tile_t **tiles, int32_t *num_tiles) {
+  bsm_header_v1_t *header = &model->header;
+  if (max_tris < 1) return false;
+  for (int32_t i = 0; i < header->num_tris; i++) {
+    for (int k = 0; k < 3; k++) {
+      if (model->tris[i].index[k] < 0 || model->tris[i].index[k] >= header->num_verts) return false;
+    }
+  }
+  for (int32_t i = 0; i < header->num_meshes; i++) {
+    bsm_mesh_t *mesh = &model->meshes[i];
+    if (mesh->idx_tris < 0 || mesh->num_tris < 0 || mesh->num_tris > header->num_tris - mesh->idx_tris) return false;
+  }
+  
+  tile_ctx_t ctx = { 0 };
+  ctx.max_tris  = max_tris;
+  ctx.centroids = malloc((size_t)header->num_tris * 3 * sizeof(float) + 1);
+  ctx.order     = malloc((size_t)header->num_tris * sizeof(tile_tri_t) + 1);
+  ctx.scratch   = malloc((size_t)header->num_tris * sizeof(tile_tri_t) + 1);
+  int32_t *stamp = malloc((size_t)header->num_verts * sizeof(int32_t) + 1);
+  int32_t *local = malloc((size_t)header->num_verts * sizeof(int32_t) + 1);
+  bool ok = ctx.centroids != NULL && ctx.order != NULL && ctx.scratch != NULL && stamp != NULL && local != NULL;
+  
+  float lo[3] = { INFINITY, INFINITY, INFINITY };
+  float hi[3] = { -INFINITY, -INFINITY, -INFINITY };
+  for (int32_t i = 0; ok && i < header->num_tris; i++) {
+    float *c = &ctx.centroids[i * 3];
+    for (int k = 0; k < 3; k++) {
+      c[k] = 0.0f;
+      for (int v = 0; v < 3; v++) c[k] += (&model->positions[model->tris[i].index[v]].x)[k];
+      c[k] /= 3.0f;
+      lo[k] = fminf(lo[k], c[k]);
+      hi[k] = fmaxf(hi[k], c[k]);
+    }
+    ctx.order[i] = (tile_tri_t){ -1, i };
+  }
+  /* a triangle in several (overlapping) meshes goes with the first */
+  for (int32_t i = header->num_meshes - 1; ok && i >= 0; i--) {
+    bsm_mesh_t *mesh = &model->meshes[i];
+    for (int32_t j = mesh->idx_tris; j < mesh->idx_tris + mesh->num_tris; j++) ctx.order[j].mesh = i;
+  }
+  if (ok && header->num_tris > 0) ok = tile_split(&ctx, 0, header->num_tris, lo, hi, 0);
+  
+  /* count the output before allocating it -- border vertices are counted once per tile that uses them */
+  int32_t out_meshes = 0;
+  int64_t out_verts = 0;
+  for (int32_t i = 0; ok && i < header->num_verts; i++) stamp[i] = -1;
+  for (int32_t t = 0; ok && t < ctx.num_leaves; t++) {
+    tile_leaf_t *leaf = &ctx.leaves[t];
+    qsort(&ctx.order[leaf->idx], leaf->num, sizeof(tile_tri_t), compare_tri);
+    for (int32_t i = leaf->idx; i < leaf->idx + leaf->num; i++) {
+      tile_tri_t *tri = &ctx.order[i];
+      if (tri->mesh >= 0 && (i == leaf->idx || tri->mesh != ctx.order[i-1].mesh)) out_meshes++;
+      for (int k = 0; k < 3; k++) {
+        int32_t index = model->tris[tri->tri].index[k];
+        if (stamp[index] != t) {
+          stamp[index] = t;
+          out_verts++;
+        }
+      }
+    }
+  }
+  ok = ok && out_verts <= INT32_MAX;
+  
+  bsm_tile_t *out_tiles = NULL;
+  bsm_position_t *positions = NULL;
+  bsm_texcoord_t *texcoords = NULL;
+  bsm_normal_t *normals = NULL;
+  bsm_tangent_t *tangents = NULL;
+  bsm_triangle_t *tris = NULL;
+  bsm_mesh_t *meshes = NULL;
+  if (ok) {
+    out_tiles = malloc(ctx.num_leaves * sizeof(bsm_tile_t) + 1);
+    positions = malloc(out_verts * sizeof(bsm_position_t) + 1);
+    texcoords = malloc(out_verts * sizeof(bsm_texcoord_t) + 1);
+    normals   = malloc(out_verts * sizeof(bsm_normal_t) + 1);
+    tangents  = malloc(out_verts * sizeof(bsm_tangent_t) + 1);
+    tris      = malloc((size_t)header->num_tris * sizeof(bsm_triangle_t) + 1);
+    meshes    = malloc(out_meshes * sizeof(bsm_mesh_t) + 1);
+    ok = out_tiles != NULL && positions != NULL && texcoords != NULL && normals != NULL && tangents != NULL &&
+      tris != NULL && meshes != NULL;
+  }
+  
+  int32_t num_verts = 0;
+  int32_t num_meshes = 0;
+  for (int32_t i = 0; ok && i < header->num_verts; i++) stamp[i] = -1;
+  for (int32_t t = 0; ok && t < ctx.num_leaves; t++) {
+    tile_leaf_t *leaf = &ctx.leaves[t];
+    bsm_tile_t *tile = &out_tiles[t];
+    tile->bbox = (bsm_bbox_t){ INFINITY, INFINITY, INFINITY, -INFINITY, -INFINITY, -INFINITY };
+    tile->idx_mesh = num_meshes;
+    tile->idx_tris = leaf->idx;
+    tile->num_tris = leaf->num;
+    tile->idx_vert = num_verts;
+    
+    for (int32_t i = leaf->idx; i < leaf->idx + leaf->num; i++) {
+      tile_tri_t *tri = &ctx.order[i];
+      if (tri->mesh >= 0 && (i == leaf->idx || tri->mesh != ctx.order[i-1].mesh)) {
+        meshes[num_meshes] = model->meshes[tri->mesh];
+        meshes[num_meshes].idx_tris = i;
+        meshes[num_meshes].num_tris = 0;
+        num_meshes++;
+      }
+      if (tri->mesh >= 0) meshes[num_meshes-1].num_tris++;
+      
+      /* vertices are numbered in order of first use, which keeps each tile's vertex fetches local */
+      for (int k = 0; k < 3; k++) {
+        int32_t index = model->tris[tri->tri].index[k];
+        if (stamp[index] != t) {
+          stamp[index] = t;
+          local[index] = num_verts;
+          positions[num_verts] = model->positions[index];
+          texcoords[num_verts] = model->texcoords[index];
+          normals[num_verts]   = model->normals[index];
+          tangents[num_verts]  = model->tangents[index];
+          
+          bsm_position_t *p = &positions[num_verts];
+          tile->bbox.x0 = fminf(tile->bbox.x0, p->x);
+          tile->bbox.y0 = fminf(tile->bbox.y0, p->y);
+          tile->bbox.z0 = fminf(tile->bbox.z0, p->z);
+          tile->bbox.x1 = fmaxf(tile->bbox.x1, p->x);
+          tile->bbox.y1 = fmaxf(tile->bbox.y1, p->y);
+          tile->bbox.z1 = fmaxf(tile->bbox.z1, p->z);
+          num_verts++;
+        }
+        tris[i].index[k] = local[index];
+      }
+    }
+    tile->num_mesh = num_meshes - tile->idx_mesh;
+    tile->num_vert = num_verts - tile->idx_vert;
+  }
+  
+  free(ctx.centroids);
+  free(ctx.order);
+  free(ctx.scratch);
+  free(ctx.leaves);
+  free(stamp);
+  free(local);
+  if (!ok) {
+    free(out_tiles);
+    free(positions);
+    free(texcoords);
+    free(normals);
+    free(tangents);
+    free(tris);
+    free(meshes);
+    return false;
+  }
+  
+  free(model->positions);
+  free(model->texcoords);
+  free(model->normals);
+  free(model->tangents);
+  free(model->tris);
+  free(model->meshes);
+  model->positions = positions;
+  model->texcoords = texcoords;
+  model->normals   = normals;
+  model->tangents  = tangents;
+  model->tris      = tris;
+  model->meshes    = meshes;
+  header->num_verts  = num_verts;
+  header->num_meshes = num_meshes;
+  *tiles     = out_tiles;
+  *num_tiles = ctx.num_leaves;
+  return true;
+}
+
+size_t bsm_layout_tiled_model(bsm_model_t *model, int32_t num_tiles, bsm_header_ext_tiles_t *header) {
+  header->header_v1 = model->header;
+  header->header_v1.extension = BSM_EXT_TILES;
+  header->num_tiles = num_tiles;
+  return bsm_layout_ext_tiles(header);
+}
+
+bool bsm_write_tiled_model(uint8_t *data, size_t n, bsm_model_t *model, bsm_header_ext_tiles_t *header, bsm_tile_t *tiles) {
+  bsm_header_v1_t *v1 = &header->header_v1;
+  return bsm_write_header_ext_tiles(data, n, header) &&
+    bsm_write_positions(data, n, v1, model->positions) &&
+    bsm_write_texcoords(data, n, v1, model->texcoords) &&
+    bsm_write_normals(data, n, v1, model->normals) &&
+    bsm_write_tangents(data, n, v1, model->tangents) &&
+    bsm_write_tris(data, n, v1, model->tris) &&
+    bsm_write_meshes(data, n, v1, model->meshes) &&
+    bsm_write_hullverts(data, n, v1, model->hullverts) &&
+    bsm_write_hulls(data, n, v1, model->hulls) &&
+    bsm_write_visverts(data, n, v1, model->visverts) &&
+    bsm_write_vistris(data, n, v1, model->vistris) &&
+    bsm_write_tiles(data, n, header, tiles);
+}
@@ -0,0 +1,27 @@
+#ifndef LIBBSM_TILE_H
+#define LIBBSM_TILE_H
+
+#include "bsm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* partitions the render geometry of a model into tiles for the tiling extension: triangles are split by centroid into
+ * an octree until no leaf holds more than max_tris of them, and every non-empty leaf becomes a tile.  vertices, triangles
+ * and meshes are then reordered tile by tile -- meshes are split per tile, vertices shared across tile borders are
+ * duplicated and vertices no triangle references are dropped.  the render chunks must be heap-allocated (as by
+ * bsm_read_model()); the tile table is allocated into *tiles and released with free().  returns false on invalid input
+ * or if memory runs out */
+bool bsm_build_tiles(bsm_model_t *model, int32_t max_tris, bsm_tile_t **tiles, int32_t *num_tiles);
+
+/* lays out and writes a tiled model with its tile table -- bsm_layout_tiled_model() fills in header and returns the file
+ * size, or 0 if it is too large */
+size_t bsm_layout_tiled_model(bsm_model_t *model, int32_t num_tiles, bsm_header_ext_tiles_t *header);
+bool bsm_write_tiled_model(uint8_t *data, size_t n, bsm_model_t *model, bsm_header_ext_tiles_t *header, bsm_tile_t *tiles);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBBSM_TILE_H */
@@ -0,0 +1,406 @@
+/* Released into the Public Domain */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <bsm.h>
+#include "diff.h"
+#include "util.h"
+
+/* splitmix64, as in bsm_sample.c */
+static uint64_t next_random(uint64_t *state) {
+  uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+static uint32_t random_below(uint64_t *state, uint32_t n) {
+  return (uint32_t)(((next_random(state) >> 32) * n) >> 32);
+}
+
+/* mostly small values, with zero vectors and arbitrary bit patterns (NaNs, infinities, denormals) mixed in */
+static void random_floats(uint64_t *state, void *dst, size_t bytes) {
+  float32_t *f = dst;
+  for (size_t i = 0; i < bytes / 4; i++) {
+    uint32_t r = random_below(state, 8);
+    if (r == 0) {
+      f[i] = 0.0f;
+    } else if (r == 1) {
+      uint32_t bits = (uint32_t)next_random(state);
+      memcpy(&f[i], &bits, 4);
+    } else {
+      f[i] = (float32_t)((int32_t)random_below(state, 2001) - 1000) / 250.0f;
+    }
+  }
+}
+
+/* mostly an index below limit, now and then one just outside it or far off */
+static int32_t random_index(uint64_t *state, int32_t limit) {
+  static const int32_t wild[] = { -1, INT32_MIN, INT32_MAX };
+  uint32_t r = random_below(state, 32);
+  if (r == 0) return limit;
+  if (r == 1) return wild[random_below(state, 3)];
+  return limit > 0 ? (int32_t)random_below(state, limit) : 0;
+}
+
+/* a range within limit, now and then one that is not */
+static void random_range(uint64_t *state, int32_t limit, int32_t *idx, int32_t *num) {
+  if (random_below(state, 16) == 0) {
+    *idx = random_index(state, limit + 1);
+    *num = random_index(state, limit + 1);
+    return;
+  }
+  *idx = random_below(state, limit + 1);
+  *num = random_below(state, limit - *idx + 1);
+}
+
+static bool generate_model(uint64_t *state, bsm_model_t *model) {
+  bsm_header_v1_t *header = &model->header;
+  bsm_init_header_v1(header, 0);
+  header->num_verts     = random_below(state, 48);
+  header->num_tris      = random_below(state, 64);
+  header->num_meshes    = random_below(state, 6);
+  header->num_hullverts = random_below(state, 16);
+  header->num_hulls     = random_below(state, 4);
+  header->num_visverts  = random_below(state, 16);
+  header->num_vistris   = random_below(state, 16);
+  if (!bsm_alloc_model(model)) return false;
+  
+  random_floats(state, model->positions, bsm_positions_bytes(header));
+  random_floats(state, model->texcoords, bsm_texcoords_bytes(header));
+  random_floats(state, model->normals, bsm_normals_bytes(header));
+  random_floats(state, model->tangents, bsm_tangents_bytes(header));
+  random_floats(state, model->hullverts, bsm_hullverts_bytes(header));
+  random_floats(state, model->visverts, bsm_visverts_bytes(header));
+  for (int32_t i = 0; i < header->num_tris; i++) {
+    for (int k = 0; k < 3; k++) model->tris[i].index[k] = random_index(state, header->num_verts);
+  }
+  for (int32_t i = 0; i < header->num_vistris; i++) {
+    for (int k = 0; k < 3; k++) model->vistris[i].index[k] = random_index(state, header->num_visverts);
+  }
+  /* meshes mostly partition the triangles in order */
+  int32_t idx_tris = 0;
+  for (int32_t i = 0; i < header->num_meshes; i++) {
+    bsm_mesh_t *mesh = &model->meshes[i];
+    mesh->idx_tris = idx_tris;
+    mesh->num_tris = i + 1 == header->num_meshes ? header->num_tris - idx_tris : (int32_t)random_below(state, header->num_tris - idx_tris + 1);
+    idx_tris += mesh->num_tris;
+    if (random_below(state, 16) == 0) random_range(state, header->num_tris, &mesh->idx_tris, &mesh->num_tris);
+    snprintf((char*)mesh->material, sizeof(mesh->material), "material%d", (int)i);
+  }
+  for (int32_t i = 0; i < header->num_hulls; i++) random_range(state, header->num_hullverts, &model->hulls[i].idx_vert, &model->hulls[i].num_vert);
+  return true;
+}
+
+static bool write_chunks(uint8_t *data, size_t n, bsm_header_v1_t *header, bsm_model_t *model) {
+  return bsm_write_positions(data, n, header, model->positions) &&
+    bsm_write_texcoords(data, n, header, model->texcoords) &&
+    bsm_write_normals(data, n, header, model->normals) &&
+    bsm_write_tangents(data, n, header, model->tangents) &&
+    bsm_write_tris(data, n, header, model->tris) &&
+    bsm_write_meshes(data, n, header, model->meshes) &&
+    bsm_write_hullverts(data, n, header, model->hullverts) &&
+    bsm_write_hulls(data, n, header, model->hulls) &&
+    bsm_write_visverts(data, n, header, model->visverts) &&
+    bsm_write_vistris(data, n, header, model->vistris);
+}
+
+static uint8_t *write_vertranges(uint64_t *state, bsm_model_t *model, size_t *size) {
+  bsm_header_ext_vertranges_t header;
+  header.header_v1 = model->header;
+  header.header_v1.extension = BSM_EXT_VERTRANGES;
+  *size = bsm_layout_ext_vertranges(&header);
+  if (*size == 0) return NULL;
+  
+  uint8_t *data = calloc(1, *size);
+  bsm_vertrange_t *vertranges = malloc(bsm_vertranges_bytes(&header) + 1);
+  if (data != NULL && vertranges != NULL) {
+    if (!bsm_compute_vertranges(&model->header, model->tris, model->meshes, vertranges) || random_below(state, 8) == 0) {
+      for (int32_t i = 0; i < header.num_vertranges; i++) random_range(state, model->header.num_verts, &vertranges[i].idx_vert, &vertranges[i].num_vert);
+    }
+    bsm_write_header_ext_vertranges(data, *size, &header);
+    write_chunks(data, *size, &header.header_v1, model);
+    bsm_write_vertranges(data, *size, &header, vertranges);
+  }
+  free(vertranges);
+  return data;
+}
+
+static uint8_t *write_hulls(uint64_t *state, bsm_model_t *model, size_t *size) {
+  bsm_header_ext_hulls_t header;
+  header.header_v1 = model->header;
+  header.header_v1.extension = BSM_EXT_HULLS;
+  header.num_hullfaces = random_below(state, 12);
+  header.num_hulledges = random_below(state, 36);
+  *size = bsm_layout_ext_hulls(&header);
+  if (*size == 0) return NULL;
+  
+  uint8_t *data = calloc(1, *size);
+  bsm_hulltopo_t *topos = malloc(bsm_hulltopos_bytes(&header) + 1);
+  bsm_hullface_t *faces = malloc(bsm_hullfaces_bytes(&header) + 1);
+  bsm_hulledge_t *edges = malloc(bsm_hulledges_bytes(&header) + 1);
+  if (data != NULL && topos != NULL && faces != NULL && edges != NULL) {
+    for (int32_t i = 0; i < header.num_hulltopos; i++) {
+      random_range(state, header.num_hullfaces, &topos[i].idx_face, &topos[i].num_face);
+      random_range(state, header.num_hulledges, &topos[i].idx_edge, &topos[i].num_edge);
+    }
+    for (int32_t i = 0; i < header.num_hullfaces; i++) {
+      random_floats(state, &faces[i], 4 * sizeof(float32_t));
+      random_range(state, header.num_hulledges, &faces[i].idx_edge, &faces[i].num_edge);
+      if (faces[i].num_edge < 3 && random_below(state, 4) != 0) faces[i].num_edge = 3;
+    }
+    for (int32_t i = 0; i < header.num_hulledges; i++) {
+      edges[i].vert = random_index(state, model->header.num_hullverts);
+      edges[i].twin = random_index(state, header.num_hulledges);
+      edges[i].face = random_index(state, header.num_hullfaces);
+    }
+    bsm_write_header_ext_hulls(data, *size, &header);
+    write_chunks(data, *size, &header.header_v1, model);
+    bsm_write_hulltopos(data, *size, &header, topos);
+    bsm_write_hullfaces(data, *size, &header, faces);
+    bsm_write_hulledges(data, *size, &header, edges);
+  }
+  free(topos);
+  free(faces);
+  free(edges);
+  return data;
+}
+
+static uint8_t *write_64(uint64_t *state, bsm_model_t *model, size_t *size) {
+  bsm_header_ext_64_t header;
+  memset(&header, 0, sizeof(header));
+  bsm_init_header_v1(&header.header_v1, BSM_EXT_64);
+  header.num_verts     = model->header.num_verts;
+  header.num_tris      = model->header.num_tris;
+  header.num_meshes    = model->header.num_meshes;
+  header.num_hullverts = model->header.num_hullverts;
+  header.num_hulls     = model->header.num_hulls;
+  header.num_visverts  = model->header.num_visverts;
+  header.num_vistris   = model->header.num_vistris;
+  *size = bsm_layout_ext_64(&header);
+  if (*size == 0) return NULL;
+  /* the v1 view left empty, as for a file beyond 2 GB */
+  if (random_below(state, 2) == 0) bsm_init_header_v1(&header.header_v1, BSM_EXT_64);
+  
+  uint8_t *data = calloc(1, *size);
+  if (data == NULL) return NULL;
+  const void *chunks[BSM_NUM_CHUNKS] = {
+    model->positions, model->texcoords, model->normals, model->tangents, model->tris,
+    model->meshes, model->hullverts, model->hulls, model->visverts, model->vistris
+  };
+  bsm_write_header_ext_64(data, *size, &header);
+  for (int c = 0; c < BSM_NUM_CHUNKS; c++) bsm_write_chunk_64(data, *size, &header, c, chunks[c]);
+  return data;
+}
+
+static uint8_t *write_tiles(uint64_t *state, bsm_model_t *model, size_t *size) {
+  bsm_header_ext_tiles_t header;
+  header.header_v1 = model->header;
+  header.header_v1.extension = BSM_EXT_TILES;
+  header.num_tiles = 1 + random_below(state, 4);
+  *size = bsm_layout_ext_tiles(&header);
+  if (*size == 0) return NULL;
+  
+  uint8_t *data = calloc(1, *size);
+  bsm_tile_t *tiles = calloc(1, bsm_tiles_bytes(&header));
+  if (data != NULL && tiles != NULL) {
+    bsm_header_v1_t *v1 = &model->header;
+    for (int32_t i = 0; i < header.num_tiles; i++) {
+      bsm_tile_t *tile = &tiles[i];
+      random_floats(state, &tile->bbox, sizeof(bsm_bbox_t));
+      if (random_below(state, 2) == 0) {
+        /* the whole model, which reads back whenever the model itself is sound */
+        tile->num_mesh = v1->num_meshes;
+        tile->num_tris = v1->num_tris;
+        tile->num_vert = v1->num_verts;
+      } else {
+        random_range(state, v1->num_meshes, &tile->idx_mesh, &tile->num_mesh);
+        random_range(state, v1->num_tris, &tile->idx_tris, &tile->num_tris);
+        random_range(state, v1->num_verts, &tile->idx_vert, &tile->num_vert);
+      }
+    }
+    bsm_write_header_ext_tiles(data, *size, &header);
+    write_chunks(data, *size, &header.header_v1, model);
+    bsm_write_tiles(data, *size, &header, tiles);
+  }
+  free(tiles);
+  return data;
+}
+
+/* a fresh model in one of the formats the library reads */
+static uint8_t *generate(uint64_t *state, size_t *size) {
+  bsm_model_t model;
+  if (!generate_model(state, &model)) return NULL;
+  
+  uint8_t *data = NULL;
+  switch (random_below(state, 5)) {
+    case 0:
+      *size = bsm_layout_model(&model);
+      data = *size > 0 ? calloc(1, *size) : NULL;
+      if (data != NULL) bsm_write_model(data, *size, &model);
+      break;
+    case 1: data = write_vertranges(state, &model, size); break;
+    case 2: data = write_hulls(state, &model, size); break;
+    case 3: data = write_64(state, &model, size); break;
+    case 4: data = write_tiles(state, &model, size); break;
+  }
+  bsm_free_model(&model);
+  return data;
+}
+
+static void put32(uint8_t *p, uint32_t x) {
+  for (int i = 0; i < 4; i++) p[i] = (uint8_t)(x >> (8 * i));
+}
+
+static void put64(uint8_t *p, uint64_t x) {
+  for (int i = 0; i < 8; i++) p[i] = (uint8_t)(x >> (8 * i));
+}
+
+static uint32_t get32(uint8_t *p) {
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+/* one mutation -- header fields get the values most likely to slip past a bounds or overlap check */
+static uint8_t *mutate(uint64_t *state, uint8_t *data, size_t *size) {
+  size_t n = *size;
+  size_t fields = (n < 0x110 ? n : 0x110) / 4;
+  switch (random_below(state, 7)) {
+    case 0:
+      if (n > 0) data[random_below(state, n)] ^= 1 << random_below(state, 8);
+      break;
+    case 1:
+      if (n > 0) data[random_below(state, n)] = (uint8_t)next_random(state);
+      break;
+    case 2:
+      if (fields > 0x10) {
+        uint8_t *field = data + 4 * (0x10 + random_below(state, fields - 0x10));
+        uint8_t *other = data + 4 * (0x10 + random_below(state, fields - 0x10));
+        uint32_t values[] = {
+          0, 1, 0xFFFFFFFF, 0x7FFFFFFF, 0x80000000, (uint32_t)n, (uint32_t)n - 1, (uint32_t)n / 12,
+          0x83, 0x84, 0x8C, 0x9C, 0x110, get32(other), get32(other) + 4, get32(field) + 1, get32(field) - 1
+        };
+        put32(field, values[random_below(state, sizeof(values) / sizeof(values[0]))]);
+      }
+      break;
+    case 3:
+      if (n >= 0x110) {
+        uint8_t *field = data + 0x88 + 8 * random_below(state, 17);
+        uint64_t values[] = {
+          0x7FFFFFFFFFFFFFFFULL, 0x8000000000000000ULL, 0xFFFFFFFFFFFFFFFFULL, 0x80000000ULL, 0x100000000ULL,
+          0x100000000ULL | get32(field), 0x0800000000000000ULL, n
+        };
+        put64(field, values[random_below(state, sizeof(values) / sizeof(values[0]))]);
+      }
+      break;
+    case 4:
+      *size = random_below(state, n + 1);
+      break;
+    case 5: {
+      size_t grow = 1 + random_below(state, 64);
+      uint8_t *bigger = realloc(data, n + grow);
+      if (bigger == NULL) break;
+      data = bigger;
+      for (size_t i = n; i < n + grow; i++) data[i] = (uint8_t)next_random(state);
+      *size = n + grow;
+      break;
+    }
+    case 6:
+      if (n > 0) {
+        size_t from = random_below(state, n), to = random_below(state, n);
+        size_t bytes = random_below(state, (n - (from > to ? from : to)) + 1);
+        memmove(data + to, data + from, bytes);
+      }
+      break;
+  }
+  return data;
+}
+
+static bool has_extension(uint8_t *data, size_t n) {
+  bsm_header_ext_vertranges_t vertranges;
+  bsm_header_ext_hulls_t hulls;
+  bsm_header_ext_64_t wide;
+  bsm_header_ext_tiles_t tiles;
+  return bsm_read_header_ext_vertranges(data, n, &vertranges) || bsm_read_header_ext_hulls(data, n, &hulls) ||
+    bsm_read_header_ext_64(data, n, &wide) || bsm_read_header_ext_tiles(data, n, &tiles);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    printf("Usage: bsmdiff <iterations> <random seed> [seed.bsm]...\n");
+    return 1;
+  }
+  long iterations = atol(argv[1]);
+  uint64_t state = strtoull(argv[2], NULL, 0);
+  
+  int num_seeds = argc - 3;
+  uint8_t **seeds = malloc((num_seeds + 1) * sizeof(uint8_t*));
+  size_t *seed_sizes = malloc((num_seeds + 1) * sizeof(size_t));
+  if (seeds == NULL || seed_sizes == NULL) {
+    printf("Out of memory!\n");
+    return 1;
+  }
+  for (int i = 0; i < num_seeds; i++) {
+    seeds[i] = read_file(argv[3 + i], &seed_sizes[i]);
+    if (seeds[i] == NULL) {
+      printf("Failed to read %s!\n", argv[3 + i]);
+      return 1;
+    }
+  }
+  
+  long num_valid = 0, num_ext = 0;
+  bool agree = true;
+  for (long i = 0; agree && i < iterations; i++) {
+    /* seed files are mutated, generated files are also checked as written */
+    size_t size = 0;
+    uint8_t *data = NULL;
+    uint32_t mutations = random_below(&state, 5);
+    if (num_seeds > 0 && random_below(&state, 2) == 0) {
+      int seed = random_below(&state, num_seeds);
+      size = seed_sizes[seed];
+      data = malloc(size > 0 ? size : 1);
+      if (data != NULL) memcpy(data, seeds[seed], size);
+      mutations++;
+    } else {
+      data = generate(&state, &size);
+    }
+    if (data == NULL) {
+      printf("Out of memory!\n");
+      return 1;
+    }
+    for (uint32_t m = 0; m < mutations; m++) data = mutate(&state, data, &size);
+  
+    /* an exact-size copy, so the sanitizer sees reads past the end */
+    uint8_t *exact = malloc(size > 0 ? size : 1);
+    if (exact == NULL) {
+      printf("Out of memory!\n");
+      return 1;
+    }
+    memcpy(exact, data, size);
+    free(data);
+  
+    const char *err = diff_check(exact, size);
+    if (err != NULL) {
+      printf("Iteration %ld: %s\n", i, err);
+      FILE *file = fopen("mismatch.bsm", "wb");
+      if (file != NULL) {
+        fwrite(exact, 1, size, file);
+        fclose(file);
+        printf("Input saved to mismatch.bsm\n");
+      }
+      agree = false;
+    }
+  
+    bsm_header_v1_t header;
+    if (bsm_read_header_v1(exact, size, &header)) num_valid++;
+    if (has_extension(exact, size)) num_ext++;
+    free(exact);
+  }
+  for (int i = 0; i < num_seeds; i++) free(seeds[i]);
+  free(seeds);
+  free(seed_sizes);
+  if (!agree) return 1;
+  
+  printf("%ld files (%ld valid, %ld with a valid extension): every reader agrees with the reference\n", iterations, num_valid, num_ext);
+  return 0;
+}
@@ -0,0 +1,48 @@
+/* Released into the Public Domain */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "diff.h"
+#include "util.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+/* any disagreement with the reference decoder is a crash, so the fuzzer keeps the input */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  /* the readers take non-const data -- an exact-size copy keeps overreads visible to the sanitizer */
+  uint8_t *copy = malloc(size > 0 ? size : 1);
+  if (copy == NULL) return 0;
+  memcpy(copy, data, size);
+  
+  const char *err = diff_check(copy, size);
+  free(copy);
+  if (err != NULL) {
+    fprintf(stderr, "%s\n", err);
+    abort();
+  }
+  return 0;
+}
+
+#ifndef BSM_LIBFUZZER
+/* without libFuzzer the harness replays the files it is given -- which is also how AFL drives it */
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    printf("Usage: bsmfuzz <input.bsm>...\n");
+    return 1;
+  }
+  
+  for (int i = 1; i < argc; i++) {
+    size_t size;
+    uint8_t *data = read_file(argv[i], &size);
+    if (data == NULL) {
+      printf("Failed to read %s!\n", argv[i]);
+      return 1;
+    }
+    LLVMFuzzerTestOneInput(data, size);
+    free(data);
+  }
+  printf("%d files: every reader agrees with the reference\n", argc - 1);
+  return 0;
+}
+#endif
@@ -0,0 +1,436 @@
+/* Released into the Public Domain */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <bsm_occluder.h>
+#include "reference.h"
+#include "diff.h"
+
+/* per-file caps on the partial-read checks, so a single input stays fast -- the whole-chunk readers are always
+ * checked in full */
+#define DIFF_MAX_TILES  64
+#define DIFF_MAX_SELECT 64
+
+static const char *kind_names[REF_NUM_KINDS] = {
+  "positions", "texcoords", "normals", "tangents", "tris", "meshes", "hullverts", "hulls", "visverts", "vistris",
+  "vertranges", "hulltopos", "hullfaces", "hulledges", "tiles"
+};
+
+static char message[256];
+
+static const char *fail(const char *path, int kind, const char *what) {
+  if (kind < 0) snprintf(message, sizeof(message), "%s: %s", path, what);
+  else snprintf(message, sizeof(message), "%s (%s): %s", path, kind_names[kind], what);
+  return message;
+}
+
+static const char *accepts(const char *path, int kind, bool ok, bool expect) {
+  if (ok == expect) return NULL;
+  return fail(path, kind, ok ? "accepts what the reference rejects" : "rejects what the reference accepts");
+}
+
+static const char *same(const char *path, int kind, const void *got, const void *want, size_t bytes) {
+  if (memcmp(got, want, bytes) == 0) return NULL;
+  return fail(path, kind, "decodes differently from the reference");
+}
+
+static bool in_range(int64_t idx, int64_t num, int64_t limit) {
+  return idx >= 0 && num >= 0 && idx + num <= limit;
+}
+
+/* reference read of a whole chunk into a new buffer -- NULL if the reference rejects it or memory runs out */
+static void *ref_alloc_chunk(uint8_t *data, size_t n, ref_file_t *ref, ref_chunk_t *chunk, bool *ok) {
+  void *out = malloc(ref_chunk_bytes(chunk) + 1);
+  *ok = out != NULL && ref_read_chunk(data, n, ref, chunk, out);
+  return out;
+}
+
+/* holds a chunk the library has read into got against the reference read of the same chunk */
+static const char *check_read(const char *path, bool ok, void *got, uint8_t *data, size_t n, ref_file_t *ref, ref_chunk_t *chunk) {
+  bool expect;
+  void *want = ref_alloc_chunk(data, n, ref, chunk, &expect);
+  if (want == NULL) return fail(path, chunk->kind, "out of memory");
+  
+  const char *err = accepts(path, chunk->kind, ok, expect);
+  if (err == NULL && ok) err = same(path, chunk->kind, got, want, ref_chunk_bytes(chunk));
+  free(want);
+  return err;
+}
+
+static const char *check_model(uint8_t *data, size_t n, ref_file_t *ref, uint8_t **expect) {
+  bsm_model_t model;
+  bool ok = bsm_read_model(data, n, &model);
+  const char *err = accepts("bsm_read_model", -1, ok, ref->valid_v1);
+  if (err != NULL || !ok) return err;
+  
+  void *chunks[BSM_NUM_CHUNKS] = {
+    model.positions, model.texcoords, model.normals, model.tangents, model.tris,
+    model.meshes, model.hullverts, model.hulls, model.visverts, model.vistris
+  };
+  for (int c = 0; err == NULL && c < BSM_NUM_CHUNKS; c++) err = same("bsm_read_model", c, chunks[c], expect[c], ref_chunk_bytes(&ref->v1[c]));
+  if (err == NULL) err = same("bsm_read_model", -1, &model.header, ref->header, sizeof(bsm_header_v1_t));
+  bsm_free_model(&model);
+  return err;
+}
+
+static const char *check_64(uint8_t *data, size_t n, ref_file_t *ref) {
+  bsm_header_ext_64_t header;
+  bool ok = bsm_read_header_64(data, n, &header);
+  const char *err = accepts("bsm_read_header_64", -1, ok, ref->valid_v1 && (ref->extension != BSM_EXT_64 || ref->valid_ext));
+  if (err != NULL || !ok) return err;
+  
+  size_t bytes = ref->extension == BSM_EXT_64 ? sizeof(bsm_header_ext_64_t) : sizeof(bsm_header_v1_t);
+  if ((err = same("bsm_read_header_64", -1, &header, ref->header, bytes))) return err;
+  for (int c = 0; err == NULL && c < BSM_NUM_CHUNKS; c++) {
+    ref_chunk_t *chunk = &ref->wide[c];
+    if (bsm_chunk_offs_64(&header, c) != (uint64_t)chunk->offs || bsm_chunk_bytes_64(&header, c) != ref_chunk_bytes(chunk)) {
+      return fail("bsm_chunk_offs_64", c, "locates the chunk differently from the reference");
+    }
+    void *got = malloc(ref_chunk_bytes(chunk) + 1);
+    if (got == NULL) return fail("bsm_read_chunk_64", c, "out of memory");
+    err = check_read("bsm_read_chunk_64", bsm_read_chunk_64(data, n, &header, c, got), got, data, n, ref, chunk);
+    free(got);
+  }
+  return err;
+}
+
+/* the gather readers on one vertex list -- valid if every entry is a vertex, and then the listed elements of the
+ * full chunks */
+static const char *check_gather(uint8_t *data, size_t n, ref_file_t *ref, uint8_t **expect, bsm_header_v1_t *header, int32_t *verts, int32_t num_verts) {
+  bool valid = true;
+  for (int32_t i = 0; i < num_verts; i++) valid = valid && in_range(verts[i], 1, header->num_verts);
+  
+  const char *err = NULL;
+  for (int c = BSM_CHUNK_POSITIONS; err == NULL && c <= BSM_CHUNK_TANGENTS; c++) {
+    size_t size = ref->v1[c].size;
+    uint8_t *got  = malloc(num_verts * size + 1);
+    uint8_t *want = malloc(num_verts * size + 1);
+    if (got == NULL || want == NULL) {
+      free(got);
+      free(want);
+      return fail("bsm_gather", c, "out of memory");
+    }
+  
+    bool ok = false;
+    switch (c) {
+      case BSM_CHUNK_POSITIONS: ok = bsm_gather_positions(data, n, header, verts, num_verts, (bsm_position_t*)got); break;
+      case BSM_CHUNK_TEXCOORDS: ok = bsm_gather_texcoords(data, n, header, verts, num_verts, (bsm_texcoord_t*)got); break;
+      case BSM_CHUNK_NORMALS:   ok = bsm_gather_normals(data, n, header, verts, num_verts, (bsm_normal_t*)got); break;
+      case BSM_CHUNK_TANGENTS:  ok = bsm_gather_tangents(data, n, header, verts, num_verts, (bsm_tangent_t*)got); break;
+    }
+    err = accepts("bsm_gather", c, ok, valid);
+    if (err == NULL && ok) {
+      for (int32_t i = 0; i < num_verts; i++) memcpy(want + i * size, expect[c] + verts[i] * size, size);
+      err = same("bsm_gather", c, got, want, num_verts * size);
+    }
+    free(got);
+    free(want);
+  }
+  return err;
+}
+
+/* vertex lists with gaps, duplicates and descending runs, then one with an index past the end */
+static const char *check_gathers(uint8_t *data, size_t n, ref_file_t *ref, uint8_t **expect, bsm_header_v1_t *header) {
+  int32_t num_verts = header->num_verts;
+  int32_t *verts = malloc((num_verts + 4) * sizeof(int32_t));
+  if (verts == NULL) return fail("bsm_gather", -1, "out of memory");
+  
+  int32_t num = 0;
+  for (int32_t i = 0; i < num_verts; i++) {
+    if ((uint32_t)i * 2654435761u >> 29 != 0) verts[num++] = i;
+  }
+  if (num_verts > 0) {
+    verts[num++] = num_verts - 1;
+    verts[num++] = num_verts / 2;
+    verts[num++] = 0;
+  }
+  const char *err = check_gather(data, n, ref, expect, header, verts, num);
+  if (err == NULL) {
+    verts[num++] = num_verts;
+    err = check_gather(data, n, ref, expect, header, verts, num);
+  }
+  free(verts);
+  return err;
+}
+
+/* reference remap: the referenced vertices in ascending order, and the triangles rewritten to their ranks */
+static int32_t ref_remap(bsm_header_v1_t *header, bsm_triangle_t *tris, int32_t num_tris, int32_t *rank, int32_t *verts) {
+  for (int32_t i = 0; i < header->num_verts; i++) rank[i] = -1;
+  for (int32_t i = 0; i < num_tris; i++) {
+    for (int k = 0; k < 3; k++) {
+      if (!in_range(tris[i].index[k], 1, header->num_verts)) return -1;
+      rank[tris[i].index[k]] = 0;
+    }
+  }
+  int32_t num_verts = 0;
+  for (int32_t i = 0; i < header->num_verts; i++) {
+    if (rank[i] < 0) continue;
+    rank[i] = num_verts;
+    verts[num_verts++] = i;
+  }
+  for (int32_t i = 0; i < num_tris; i++) {
+    for (int k = 0; k < 3; k++) tris[i].index[k] = rank[tris[i].index[k]];
+  }
+  return num_verts;
+}
+
+static const char *check_remap(uint8_t *data, size_t n, ref_file_t *ref, uint8_t **expect, bsm_header_v1_t *header, bsm_triangle_t *tris, int32_t num_tris) {
+  size_t bytes = num_tris * sizeof(bsm_triangle_t);
+  bsm_triangle_t *want = malloc(bytes + 1);
+  int32_t *rank  = malloc(bsm_submesh_remap_bytes(header) + 1);
+  int32_t *remap = malloc(bsm_submesh_remap_bytes(header) + 1);
+  int32_t *verts_got  = malloc(header->num_verts * sizeof(int32_t) + 1);
+  int32_t *verts_want = malloc(header->num_verts * sizeof(int32_t) + 1);
+  const char *err = NULL;
+  if (want == NULL || rank == NULL || remap == NULL || verts_got == NULL || verts_want == NULL) err = fail("bsm_submesh_remap", -1, "out of memory");
+  
+  if (err == NULL) {
+    memcpy(want, tris, bytes);
+    int32_t num_got  = bsm_submesh_remap(header, tris, num_tris, remap, verts_got);
+    int32_t num_want = ref_remap(header, want, num_tris, rank, verts_want);
+    if (num_got != num_want) err = fail("bsm_submesh_remap", -1, "counts vertices differently from the reference");
+    else if (num_got >= 0) {
+      err = same("bsm_submesh_remap", BSM_CHUNK_TRIS, tris, want, bytes);
+      if (err == NULL) err = same("bsm_submesh_remap", -1, verts_got, verts_want, num_got * sizeof(int32_t));
+      if (err == NULL) err = check_gather(data, n, ref, expect, header, verts_got, num_got);
+    }
+  }
+  free(want);
+  free(rank);
+  free(remap);
+  free(verts_got);
+  free(verts_want);
+  return err;
+}
+
+/* one mesh selection: valid if every entry is a mesh whose triangles lie in the chunk, and then their triangles in
+ * selection order */
+static const char *check_selection(uint8_t *data, size_t n, ref_file_t *ref, uint8_t **expect, bsm_header_v1_t *header, int32_t *select, int32_t num_select) {
+  bsm_mesh_t *meshes = (bsm_mesh_t*)expect[BSM_CHUNK_MESHES];
+  bsm_triangle_t *tris = (bsm_triangle_t*)expect[BSM_CHUNK_TRIS];
+  int64_t total = 0;
+  for (int32_t i = 0; i < num_select && total >= 0; i++) {
+    if (!in_range(select[i], 1, header->num_meshes)) total = -1;
+    else if (!in_range(meshes[select[i]].idx_tris, meshes[select[i]].num_tris, header->num_tris)) total = -1;
+    else if ((total += meshes[select[i]].num_tris) > INT32_MAX) total = -1;
+  }
+  if (bsm_submesh_tris(header, meshes, select, num_select) != total) return fail("bsm_submesh_tris", -1, "counts triangles differently from the reference");
+  if (total < 0) return NULL;
+  
+  bsm_triangle_t *got  = malloc(total * sizeof(bsm_triangle_t) + 1);
+  bsm_triangle_t *want = malloc(total * sizeof(bsm_triangle_t) + 1);
+  bsm_mesh_t *submeshes_got  = malloc(num_select * sizeof(bsm_mesh_t) + 1);
+  bsm_mesh_t *submeshes_want = malloc(num_select * sizeof(bsm_mesh_t) + 1);
+  const char *err = NULL;
+  if (got == NULL || want == NULL || submeshes_got == NULL || submeshes_want == NULL) err = fail("bsm_read_submesh_tris", -1, "out of memory");
+  else if (!bsm_read_submesh_tris(data, n, header, meshes, select, num_select, got, submeshes_got)) err = accepts("bsm_read_submesh_tris", -1, false, true);
+  
+  if (err == NULL) {
+    int32_t idx_tris = 0;
+    for (int32_t i = 0; i < num_select; i++) {
+      bsm_mesh_t *mesh = &meshes[select[i]];
+      memcpy(&want[idx_tris], &tris[mesh->idx_tris], mesh->num_tris * sizeof(bsm_triangle_t));
+      submeshes_want[i] = *mesh;
+      submeshes_want[i].idx_tris = idx_tris;
+      idx_tris += mesh->num_tris;
+    }
+    err = same("bsm_read_submesh_tris", BSM_CHUNK_TRIS, got, want, total * sizeof(bsm_triangle_t));
+    if (err == NULL) err = same("bsm_read_submesh_tris", BSM_CHUNK_MESHES, submeshes_got, submeshes_want, num_select * sizeof(bsm_mesh_t));
+    if (err == NULL) err = check_remap(data, n, ref, expect, header, got, total);
+  }
+  free(got);
+  free(want);
+  free(submeshes_got);
+  free(submeshes_want);
+  return err;
+}
+
+/* all meshes, the same backwards, and a selection naming a mesh that does not exist */
+static const char *check_submeshes(uint8_t *data, size_t n, ref_file_t *ref, uint8_t **expect, bsm_header_v1_t *header) {
+  int32_t select[DIFF_MAX_SELECT + 1];
+  int32_t num_select = header->num_meshes < DIFF_MAX_SELECT ? header->num_meshes : DIFF_MAX_SELECT;
+  for (int32_t i = 0; i < num_select; i++) select[i] = i;
+  
+  const char *err = check_selection(data, n, ref, expect, header, select, num_select);
+  for (int32_t i = 0; i < num_select; i++) select[i] = num_select - 1 - i;
+  if (err == NULL) err = check_selection(data, n, ref, expect, header, select, num_select);
+  select[num_select] = header->num_meshes;
+  if (err == NULL) err = check_selection(data, n, ref, expect, header, select, num_select + 1);
+  return err;
+}
+
+/* one tile read two ways: vertex chunks only, which just needs the tile ranges to be valid, and everything, which
+ * also needs every triangle corner inside the tile's vertices and every mesh inside its triangles */
+static const char *check_tile(uint8_t *data, size_t n, ref_file_t *ref, uint8_t **expect, bsm_header_ext_tiles_t *header, bsm_tile_t *tile) {
+  bsm_header_v1_t *v1 = &header->header_v1;
+  bool valid = in_range(tile->idx_mesh, tile->num_mesh, v1->num_meshes) &&
+    in_range(tile->idx_tris, tile->num_tris, v1->num_tris) &&
+    in_range(tile->idx_vert, tile->num_vert, v1->num_verts);
+  
+  size_t sizes[BSM_CHUNK_MESHES + 1];
+  int64_t first[BSM_CHUNK_MESHES + 1], count[BSM_CHUNK_MESHES + 1];
+  uint8_t *got[BSM_CHUNK_MESHES + 1], *want[BSM_CHUNK_MESHES + 1];
+  bool out_of_memory = false;
+  for (int c = 0; c <= BSM_CHUNK_MESHES; c++) {
+    sizes[c] = ref->v1[c].size;
+    first[c] = c < BSM_CHUNK_TRIS ? tile->idx_vert : c == BSM_CHUNK_TRIS ? tile->idx_tris : tile->idx_mesh;
+    count[c] = !valid ? 0 : c < BSM_CHUNK_TRIS ? tile->num_vert : c == BSM_CHUNK_TRIS ? tile->num_tris : tile->num_mesh;
+    got[c]  = malloc(count[c] * sizes[c] + 1);
+    want[c] = malloc(count[c] * sizes[c] + 1);
+    if (got[c] == NULL || want[c] == NULL) out_of_memory = true;
+    else if (valid) memcpy(want[c], expect[c] + first[c] * sizes[c], count[c] * sizes[c]);
+  }
+  
+  const char *err = NULL;
+  if (out_of_memory) err = fail("bsm_read_tile", -1, "out of memory");
+  
+  bool ok = false;
+  if (err == NULL) {
+    ok = bsm_read_tile(data, n, header, tile, (bsm_position_t*)got[0], (bsm_texcoord_t*)got[1], (bsm_normal_t*)got[2], (bsm_tangent_t*)got[3], NULL, NULL);
+    err = accepts("bsm_read_tile", -1, ok, valid);
+  }
+  for (int c = 0; err == NULL && ok && c < BSM_CHUNK_TRIS; c++) err = same("bsm_read_tile", c, got[c], want[c], count[c] * sizes[c]);
+  
+  if (err == NULL && valid) {
+    bsm_triangle_t *tris = (bsm_triangle_t*)want[BSM_CHUNK_TRIS];
+    for (int64_t i = 0; i < count[BSM_CHUNK_TRIS]; i++) {
+      for (int k = 0; k < 3; k++) {
+        int64_t index = (int64_t)tris[i].index[k] - tile->idx_vert;
+        if (!in_range(index, 1, tile->num_vert)) valid = false;
+        else tris[i].index[k] = (int32_t)index;
+      }
+    }
+    bsm_mesh_t *meshes = (bsm_mesh_t*)want[BSM_CHUNK_MESHES];
+    for (int64_t i = 0; i < count[BSM_CHUNK_MESHES]; i++) {
+      int64_t idx_tris = (int64_t)meshes[i].idx_tris - tile->idx_tris;
+      if (!in_range(idx_tris, meshes[i].num_tris, tile->num_tris)) valid = false;
+      else meshes[i].idx_tris = (int32_t)idx_tris;
+    }
+    ok = bsm_read_tile(data, n, header, tile, (bsm_position_t*)got[0], (bsm_texcoord_t*)got[1], (bsm_normal_t*)got[2], (bsm_tangent_t*)got[3], (bsm_triangle_t*)got[4], (bsm_mesh_t*)got[5]);
+    err = accepts("bsm_read_tile", -1, ok, valid);
+    for (int c = 0; err == NULL && ok && c <= BSM_CHUNK_MESHES; c++) err = same("bsm_read_tile", c, got[c], want[c], count[c] * sizes[c]);
+  }
+  for (int c = 0; c <= BSM_CHUNK_MESHES; c++) {
+    free(got[c]);
+    free(want[c]);
+  }
+  return err;
+}
+
+/* each extension reader must accept exactly the files carrying that extension with a valid header */
+static const char *check_exts(uint8_t *data, size_t n, ref_file_t *ref, uint8_t **expect) {
+  bsm_header_ext_vertranges_t vertranges;
+  bsm_header_ext_hulls_t hulls;
+  bsm_header_ext_64_t wide;
+  bsm_header_ext_tiles_t tiles;
+  bool ok[4] = {
+    bsm_read_header_ext_vertranges(data, n, &vertranges),
+    bsm_read_header_ext_hulls(data, n, &hulls),
+    bsm_read_header_ext_64(data, n, &wide),
+    bsm_read_header_ext_tiles(data, n, &tiles)
+  };
+  static const int32_t ids[4] = { BSM_EXT_VERTRANGES, BSM_EXT_HULLS, BSM_EXT_64, BSM_EXT_TILES };
+  static const char *paths[4] = { "bsm_read_header_ext_vertranges", "bsm_read_header_ext_hulls", "bsm_read_header_ext_64", "bsm_read_header_ext_tiles" };
+  void *headers[4] = { &vertranges, &hulls, &wide, &tiles };
+  size_t sizes[4] = { sizeof(vertranges), sizeof(hulls), sizeof(wide), sizeof(tiles) };
+  const char *err = NULL;
+  for (int i = 0; err == NULL && i < 4; i++) {
+    err = accepts(paths[i], -1, ok[i], ref->valid_v1 && ref->extension == ids[i] && ref->valid_ext);
+    if (err == NULL && ok[i]) err = same(paths[i], -1, headers[i], ref->header, sizes[i]);
+  }
+  
+  /* chunk readers of whichever extension the file carries */
+  void *got[REF_MAX_EXT_CHUNKS] = { NULL };
+  bool read[REF_MAX_EXT_CHUNKS] = { false };
+  for (int i = 0; err == NULL && ref->valid_ext && i < ref->num_ext; i++) {
+    got[i] = malloc(ref_chunk_bytes(&ref->ext[i]) + 1);
+    if (got[i] == NULL) err = fail("check_exts", ref->ext[i].kind, "out of memory");
+  }
+  if (err == NULL && ok[0]) read[0] = bsm_read_vertranges(data, n, &vertranges, got[0]);
+  if (err == NULL && ok[1]) {
+    read[0] = bsm_read_hulltopos(data, n, &hulls, got[0]);
+    read[1] = bsm_read_hullfaces(data, n, &hulls, got[1]);
+    read[2] = bsm_read_hulledges(data, n, &hulls, got[2]);
+  }
+  if (err == NULL && ok[3]) read[0] = bsm_read_tiles(data, n, &tiles, got[0]);
+  for (int i = 0; err == NULL && ref->valid_ext && i < ref->num_ext; i++) {
+    err = check_read("extension chunk reader", read[i], got[i], data, n, ref, &ref->ext[i]);
+  }
+  for (int32_t i = 0; err == NULL && ok[3] && read[0] && i < tiles.num_tiles && i < DIFF_MAX_TILES; i++) {
+    err = check_tile(data, n, ref, expect, &tiles, &((bsm_tile_t*)got[0])[i]);
+  }
+  for (int i = 0; i < ref->num_ext; i++) free(got[i]);
+  return err;
+}
+
+/* appending an occluder keeps every valid header the file carries valid (an extension chunk that overlapped the old
+ * occluder may even become valid), leaves the other chunks where they were and reads back as appended -- it is
+ * refused only where the v1 header, or a 64-bit header, is already invalid */
+static const char *check_occluder(uint8_t *data, size_t n, ref_file_t *ref) {
+  bsm_visvert_t visverts[8];
+  bsm_vistri_t vistris[2] = { { { 0, 1, 2 } }, { { 5, 7, 6 } } };
+  for (int i = 0; i < 8; i++) visverts[i] = (bsm_visvert_t){ i & 1, (i >> 1) & 1, (i >> 2) & 1 };
+  bsm_model_t occluder;
+  memset(&occluder, 0, sizeof(occluder));
+  occluder.header.num_visverts = 8;
+  occluder.header.num_vistris  = 2;
+  occluder.visverts = visverts;
+  occluder.vistris  = vistris;
+  
+  size_t size = bsm_append_occluder_bytes(n, &occluder);
+  uint8_t *out = malloc(size);
+  if (out == NULL) return fail("bsm_append_occluder", -1, "out of memory");
+  bool ok = bsm_append_occluder(data, n, &occluder, out, size);
+  const char *err = accepts("bsm_append_occluder", -1, ok, ref->valid_v1 && (ref->extension != BSM_EXT_64 || ref->valid_ext));
+  
+  ref_file_t after;
+  if (err == NULL && ok) {
+    ref_parse(out, size, &after);
+    if (!after.valid_v1 || after.extension != ref->extension || (ref->valid_ext && !after.valid_ext)) {
+      err = fail("bsm_append_occluder", -1, "writes a file whose headers the reference no longer accepts");
+    }
+  }
+  for (int c = 0; err == NULL && ok && c < BSM_CHUNK_VISVERTS; c++) {
+    if (after.wide[c].offs != ref->wide[c].offs || after.wide[c].count != ref->wide[c].count) err = fail("bsm_append_occluder", c, "moves a chunk it should leave alone");
+  }
+  void *got[2] = { visverts, vistris };
+  for (int c = BSM_CHUNK_VISVERTS; err == NULL && ok && c <= BSM_CHUNK_VISTRIS; c++) {
+    bool read;
+    void *want = ref_alloc_chunk(out, size, &after, &after.wide[c], &read);
+    if (want == NULL) err = fail("bsm_append_occluder", c, "out of memory");
+    else if (!read || ref_chunk_bytes(&after.wide[c]) != bsm_chunk_bytes(&occluder.header, c)) err = fail("bsm_append_occluder", c, "appends a chunk that does not read back");
+    else err = same("bsm_append_occluder", c, got[c - BSM_CHUNK_VISVERTS], want, bsm_chunk_bytes(&occluder.header, c));
+    free(want);
+  }
+  free(out);
+  return err;
+}
+
+const char *diff_check(uint8_t *data, size_t n) {
+  ref_file_t ref;
+  ref_parse(data, n, &ref);
+  
+  bsm_header_v1_t header;
+  bool ok = bsm_read_header_v1(data, n, &header);
+  const char *err = accepts("bsm_read_header_v1", -1, ok, ref.valid_v1);
+  if (err == NULL && ok) err = same("bsm_read_header_v1", -1, &header, ref.header, sizeof(header));
+  if (err != NULL) return err;
+  
+  /* the reference decode of every v1 chunk, which the partial readers are cut from */
+  uint8_t *expect[BSM_NUM_CHUNKS] = { NULL };
+  for (int c = 0; err == NULL && ok && c < BSM_NUM_CHUNKS; c++) {
+    bool read;
+    expect[c] = ref_alloc_chunk(data, n, &ref, &ref.v1[c], &read);
+    if (!read) err = fail("reference", c, "cannot decode a chunk of a valid file");
+  }
+  
+  if (err == NULL) err = check_model(data, n, &ref, expect);
+  if (err == NULL) err = check_64(data, n, &ref);
+  if (err == NULL) err = check_exts(data, n, &ref, expect);
+  if (err == NULL && ok) err = check_gathers(data, n, &ref, expect, &header);
+  if (err == NULL && ok) err = check_submeshes(data, n, &ref, expect, &header);
+  if (err == NULL) err = check_occluder(data, n, &ref);
+  for (int c = 0; c < BSM_NUM_CHUNKS; c++) free(expect[c]);
+  return err;
+}
@@ -0,0 +1,14 @@
+/* Released into the Public Domain */
+
+#ifndef BSM_FUZZ_DIFF_H
+#define BSM_FUZZ_DIFF_H
+
+#include <bsm.h>
+
+/* runs every reader path of the library over one file and holds it against the reference decoder: each path must
+ * accept exactly the files the reference accepts and decode them to the same bytes.  data should be exactly n bytes
+ * long so that overreads fault under the address sanitizer.  returns NULL if all paths agree, or a description of the
+ * first disagreement.  new load paths get a check_*() of their own here before they are used */
+const char *diff_check(uint8_t *data, size_t n);
+
+#endif /* BSM_FUZZ_DIFF_H */
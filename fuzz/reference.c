@@ -0,0 +1,218 @@
+/* Released into the Public Domain */
+
+#include <string.h>
+#include <math.h>
+#include "reference.h"
+
+#define REF_HEADER_V1 0x84
+
+/* element sizes and header field addresses, straight from the spec */
+static const size_t ref_sizes[REF_NUM_KINDS] = { 12, 8, 12, 16, 12, 264, 12, 8, 12, 12, 8, 16, 24, 12, 48 };
+static const size_t v1_count_at[BSM_NUM_CHUNKS] = { 0x40, 0x40, 0x40, 0x40, 0x54, 0x5C, 0x64, 0x6C, 0x74, 0x7C };
+static const size_t v1_offs_at[BSM_NUM_CHUNKS]  = { 0x44, 0x48, 0x4C, 0x50, 0x58, 0x60, 0x68, 0x70, 0x78, 0x80 };
+static const uint32_t ref_magic[4] = { 0x414E4942, 0x54535952, 0x43495441, 0x4853454D };
+
+static uint32_t le32(const uint8_t *p) {
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t le64(const uint8_t *p) {
+  return (uint64_t)le32(p) | (uint64_t)le32(p + 4) << 32;
+}
+
+static int32_t field32(const uint8_t *data, size_t at) {
+  uint32_t x = le32(data + at);
+  int32_t v;
+  memcpy(&v, &x, 4);
+  return v;
+}
+
+static int64_t field64(const uint8_t *data, size_t at) {
+  uint64_t x = le64(data + at);
+  int64_t v;
+  memcpy(&v, &x, 8);
+  return v;
+}
+
+/* a native field of an already decoded element */
+static int32_t at32(const uint8_t *p, size_t at) {
+  int32_t v;
+  memcpy(&v, p + at, 4);
+  return v;
+}
+
+/* decodes the header image from 'from' up to 'to' */
+static void image32(ref_file_t *file, const uint8_t *data, size_t from, size_t to) {
+  for (size_t i = from; i < to; i += 4) {
+    uint32_t x = le32(data + i);
+    memcpy(file->header + i, &x, 4);
+  }
+}
+
+static void image64(ref_file_t *file, const uint8_t *data, size_t from, size_t to) {
+  for (size_t i = from; i < to; i += 8) {
+    uint64_t x = le64(data + i);
+    memcpy(file->header + i, &x, 8);
+  }
+}
+
+static ref_chunk_t chunk32(const uint8_t *data, int kind, size_t count_at, size_t offs_at) {
+  ref_chunk_t chunk = { kind, field32(data, count_at), field32(data, offs_at), ref_sizes[kind] };
+  return chunk;
+}
+
+/* chunk end, only ever formed for counts that cannot overflow it */
+static bool ref_fits(ref_chunk_t *chunk, size_t n) {
+  if (chunk->count < 0 || chunk->count > INT32_MAX || chunk->offs < 0) return false;
+  return (uint64_t)chunk->offs + (uint64_t)chunk->count * chunk->size <= n;
+}
+
+static bool ref_valid(ref_chunk_t *chunks, int num, size_t header_bytes, size_t n) {
+  for (int i = 0; i < num; i++) {
+    if (!ref_fits(&chunks[i], n)) return false;
+  }
+  for (int i = 0; i < num; i++) {
+    uint64_t a0 = chunks[i].offs, a1 = a0 + chunks[i].count * chunks[i].size;
+    if (a0 == a1) continue;
+    if (a0 < header_bytes) return false;
+    for (int j = 0; j < num; j++) {
+      uint64_t b0 = chunks[j].offs, b1 = b0 + chunks[j].count * chunks[j].size;
+      if (j == i || b0 == b1) continue;
+      if (a0 < b1 && b0 < a1) return false;
+    }
+  }
+  return true;
+}
+
+/* the v1 chunks followed by those of the extension */
+static bool ref_valid_ext(ref_file_t *file, size_t header_bytes, size_t n) {
+  ref_chunk_t all[BSM_NUM_CHUNKS + REF_MAX_EXT_CHUNKS];
+  memcpy(all, file->v1, sizeof(file->v1));
+  memcpy(all + BSM_NUM_CHUNKS, file->ext, file->num_ext * sizeof(ref_chunk_t));
+  return ref_valid(all, BSM_NUM_CHUNKS + file->num_ext, header_bytes, n);
+}
+
+static bool ref_valid_64(ref_file_t *file, const uint8_t *data, size_t n) {
+  bool empty = true, mirror = true;
+  for (int c = 0; c < BSM_NUM_CHUNKS; c++) {
+    ref_chunk_t wide = { c, field64(data, 0x88 + 2 * (v1_count_at[c] - 0x40)), field64(data, 0x88 + 2 * (v1_offs_at[c] - 0x40)), ref_sizes[c] };
+    if (file->v1[c].count != 0 || file->v1[c].offs != 0) empty = false;
+    if (file->v1[c].count != wide.count || file->v1[c].offs != wide.offs) mirror = false;
+    file->wide[c] = wide;
+  }
+  return (empty || mirror) && ref_valid(file->wide, BSM_NUM_CHUNKS, sizeof(bsm_header_ext_64_t), n);
+}
+
+void ref_parse(const uint8_t *data, size_t n, ref_file_t *file) {
+  memset(file, 0, sizeof(ref_file_t));
+  if (n < REF_HEADER_V1) return;
+  for (int i = 0; i < 4; i++) {
+    if (le32(data + 4 * i) != ref_magic[i]) return;
+  }
+  
+  image32(file, data, 0, REF_HEADER_V1);
+  file->extension = field32(data, 0x14);
+  for (int c = 0; c < BSM_NUM_CHUNKS; c++) file->v1[c] = chunk32(data, c, v1_count_at[c], v1_offs_at[c]);
+  file->valid_v1 = ref_valid(file->v1, BSM_NUM_CHUNKS, REF_HEADER_V1, n);
+  if (!file->valid_v1) return;
+  memcpy(file->wide, file->v1, sizeof(file->v1));
+  
+  switch (file->extension) {
+    case BSM_EXT_VERTRANGES:
+      if (n < 0x8C) return;
+      image32(file, data, REF_HEADER_V1, 0x8C);
+      file->num_ext = 1;
+      file->ext[0] = chunk32(data, REF_VERTRANGES, 0x84, 0x88);
+      file->valid_ext = file->ext[0].count == file->v1[BSM_CHUNK_MESHES].count && ref_valid_ext(file, 0x8C, n);
+      return;
+    case BSM_EXT_HULLS:
+      if (n < 0x9C) return;
+      image32(file, data, REF_HEADER_V1, 0x9C);
+      file->num_ext = 3;
+      file->ext[0] = chunk32(data, REF_HULLTOPOS, 0x84, 0x88);
+      file->ext[1] = chunk32(data, REF_HULLFACES, 0x8C, 0x90);
+      file->ext[2] = chunk32(data, REF_HULLEDGES, 0x94, 0x98);
+      file->valid_ext = file->ext[0].count == file->v1[BSM_CHUNK_HULLS].count && ref_valid_ext(file, 0x9C, n);
+      return;
+    case BSM_EXT_64:
+      if (n < sizeof(bsm_header_ext_64_t)) return;
+      image32(file, data, REF_HEADER_V1, 0x88);
+      image64(file, data, 0x88, sizeof(bsm_header_ext_64_t));
+      file->valid_ext = ref_valid_64(file, data, n);
+      return;
+    case BSM_EXT_TILES:
+      if (n < 0x8C) return;
+      image32(file, data, REF_HEADER_V1, 0x8C);
+      file->num_ext = 1;
+      file->ext[0] = chunk32(data, REF_TILES, 0x84, 0x88);
+      file->valid_ext = ref_valid_ext(file, 0x8C, n);
+      return;
+  }
+}
+
+size_t ref_chunk_bytes(ref_chunk_t *chunk) {
+  return chunk->count * chunk->size;
+}
+
+static bool in_range(int32_t idx, int32_t num, int64_t limit) {
+  return idx >= 0 && num >= 0 && (int64_t)idx + num <= limit;
+}
+
+static int64_t ext_count(ref_file_t *file, int kind) {
+  for (int i = 0; i < file->num_ext; i++) {
+    if (file->ext[i].kind == kind) return file->ext[i].count;
+  }
+  return 0;
+}
+
+bool ref_read_chunk(const uint8_t *data, size_t n, ref_file_t *file, ref_chunk_t *chunk, void *out) {
+  if (!ref_fits(chunk, n)) return false;
+  
+  uint8_t *dst = out;
+  size_t bytes = ref_chunk_bytes(chunk);
+  for (size_t i = 0; i < bytes; i += 4) {
+    uint32_t x = le32(data + chunk->offs + i);
+    memcpy(dst + i, &x, 4);
+  }
+  
+  int64_t num_verts = file->v1[BSM_CHUNK_POSITIONS].count;
+  for (int64_t i = 0; i < chunk->count; i++) {
+    uint8_t *e = dst + i * chunk->size;
+    switch (chunk->kind) {
+      case BSM_CHUNK_NORMALS:
+      case BSM_CHUNK_TANGENTS: {
+        /* normalization is part of the decoded result, so this is the library's arithmetic exactly */
+        float32_t v[4];
+        memcpy(v, e, chunk->size);
+        float m = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        v[0] /= m;
+        v[1] /= m;
+        v[2] /= m;
+        if (chunk->kind == BSM_CHUNK_TANGENTS) v[3] = v[3] >= 0.0f ? 1.0f : -1.0f;
+        memcpy(e, v, chunk->size);
+        break;
+      }
+      case REF_VERTRANGES:
+        if (!in_range(at32(e, 0), at32(e, 4), num_verts)) return false;
+        break;
+      case REF_HULLTOPOS:
+        if (!in_range(at32(e, 0), at32(e, 4), ext_count(file, REF_HULLFACES))) return false;
+        if (!in_range(at32(e, 8), at32(e, 12), ext_count(file, REF_HULLEDGES))) return false;
+        break;
+      case REF_HULLFACES:
+        if (!in_range(at32(e, 16), at32(e, 20), ext_count(file, REF_HULLEDGES)) || at32(e, 20) < 3) return false;
+        break;
+      case REF_HULLEDGES:
+        if (!in_range(at32(e, 0), 1, file->v1[BSM_CHUNK_HULLVERTS].count)) return false;
+        if (!in_range(at32(e, 4), 1, ext_count(file, REF_HULLEDGES))) return false;
+        if (!in_range(at32(e, 8), 1, ext_count(file, REF_HULLFACES))) return false;
+        break;
+      case REF_TILES:
+        if (!in_range(at32(e, 24), at32(e, 28), file->v1[BSM_CHUNK_MESHES].count)) return false;
+        if (!in_range(at32(e, 32), at32(e, 36), file->v1[BSM_CHUNK_TRIS].count)) return false;
+        if (!in_range(at32(e, 40), at32(e, 44), num_verts)) return false;
+        break;
+    }
+  }
+  return true;
+}
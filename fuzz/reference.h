@@ -0,0 +1,54 @@
+/* Released into the Public Domain */
+
+#ifndef BSM_FUZZ_REFERENCE_H
+#define BSM_FUZZ_REFERENCE_H
+
+#include <bsm.h>
+
+/* reference decoder -- a plain, slow reading of the format that shares no code with bsm.c: fields are assembled byte by
+ * byte, chunk ends are summed in 64 bits only after the counts are range checked, and overlaps are tested pairwise.
+ * every reader of the library must agree with it bit for bit */
+
+/* what a chunk holds -- the v1 chunks keep their bsm_chunk_t values */
+typedef enum ref_kind {
+  REF_VERTRANGES = BSM_NUM_CHUNKS,
+  REF_HULLTOPOS,
+  REF_HULLFACES,
+  REF_HULLEDGES,
+  REF_TILES,
+  REF_NUM_KINDS
+} ref_kind_t;
+
+typedef struct ref_chunk {
+  int kind;
+  int64_t count;
+  int64_t offs;
+  size_t size;
+} ref_chunk_t;
+
+#define REF_MAX_EXT_CHUNKS 3
+
+/* a file as the reference sees it.  header is the decoded image of the longest header the file carries, to compare
+ * with the library's header structs byte for byte.  ext lists the chunks a VRNG, HULL or TILE extension adds, and wide
+ * the 64-bit view of the v1 chunks -- read from a BS64 header, otherwise widened from v1 as bsm_read_header_64() does */
+typedef struct ref_file {
+  bool valid_v1;
+  bool valid_ext;
+  int32_t extension;
+  uint8_t header[sizeof(bsm_header_ext_64_t)];
+  ref_chunk_t v1[BSM_NUM_CHUNKS];
+  ref_chunk_t wide[BSM_NUM_CHUNKS];
+  int num_ext;
+  ref_chunk_t ext[REF_MAX_EXT_CHUNKS];
+} ref_file_t;
+
+void ref_parse(const uint8_t *data, size_t n, ref_file_t *file);
+
+/* bytes of the decoded chunk, as the library sizes its buffers */
+size_t ref_chunk_bytes(ref_chunk_t *chunk);
+
+/* decodes a whole chunk (normalizing normals and tangents) and checks its contents the way the library readers do --
+ * returns false where they would */
+bool ref_read_chunk(const uint8_t *data, size_t n, ref_file_t *file, ref_chunk_t *chunk, void *out);
+
+#endif /* BSM_FUZZ_REFERENCE_H */
@@ -0,0 +1,151 @@
+/* Released into the Public Domain */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <bsm_batch.h>
+#include "util.h"
+
+/* each line of the instance list is "<model.bsm> x y z" (a translation) or "<model.bsm>" followed by a
+ * column-major 4x4 matrix of 16 numbers */
+static bool parse_instance(char *line, char **path, float32_t *m) {
+  static const float32_t identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+  float32_t v[16];
+  int n = 0;
+  
+  *path = strtok(line, " \t\r\n");
+  if (*path == NULL || **path == '#') return false;
+  for (char *tok = strtok(NULL, " \t\r\n"); tok != NULL && n < 16; tok = strtok(NULL, " \t\r\n")) {
+    v[n++] = strtof(tok, NULL);
+  }
+  memcpy(m, identity, sizeof(identity));
+  if (n == 16) {
+    memcpy(m, v, sizeof(v));
+  } else if (n == 3) {
+    m[12] = v[0];
+    m[13] = v[1];
+    m[14] = v[2];
+  } else if (n != 0) {
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    printf("Usage: bsmbatch <instance list> <output.bsm>\n");
+    return 1;
+  }
+  
+  FILE *list = fopen(argv[1], "r");
+  if (list == NULL) {
+    printf("Failed to open instance list!\n");
+    return 1;
+  }
+  
+  char **paths = NULL;
+  bsm_model_t *models = NULL;
+  bsm_batch_instance_t *instances = NULL;
+  int32_t num_models = 0, num_instances = 0;
+  char line[0x1000];
+  for (int lineno = 1; fgets(line, sizeof(line), list) != NULL; lineno++) {
+    char *path;
+    float32_t m[16];
+    if (strspn(line, " \t\r\n") == strlen(line) || line[strspn(line, " \t")] == '#') continue;
+    if (!parse_instance(line, &path, m)) {
+      printf("Malformed instance on line %d!\n", lineno);
+      return 1;
+    }
+    
+    int32_t model = 0;
+    while (model < num_models && strcmp(paths[model], path) != 0) model++;
+    if (model == num_models) {
+      size_t size;
+      uint8_t *data = read_file(path, &size);
+      if (data == NULL) {
+        printf("Failed to read %s!\n", path);
+        return 1;
+      }
+      char **grown_paths = realloc(paths, (num_models + 1) * sizeof(char*));
+      if (grown_paths != NULL) paths = grown_paths;
+      bsm_model_t *grown_models = realloc(models, (num_models + 1) * sizeof(bsm_model_t));
+      if (grown_models != NULL) models = grown_models;
+      if (grown_paths == NULL || grown_models == NULL || (paths[num_models] = malloc(strlen(path) + 1)) == NULL) {
+        printf("Out of memory!\n");
+        return 1;
+      }
+      strcpy(paths[num_models], path);
+      if (!bsm_read_model(data, size, &models[num_models])) {
+        printf("%s is not a valid Binary Static Mesh!\n", path);
+        return 1;
+      }
+      free(data);
+      num_models++;
+    }
+    
+    bsm_batch_instance_t *grown = realloc(instances, (num_instances + 1) * sizeof(bsm_batch_instance_t));
+    if (grown == NULL) {
+      printf("Out of memory!\n");
+      return 1;
+    }
+    instances = grown;
+    instances[num_instances].model = model;
+    memcpy(instances[num_instances].transform, m, sizeof(m));
+    num_instances++;
+  }
+  fclose(list);
+  
+  int32_t num_ranges = bsm_batch_ranges(models, num_models, instances, num_instances);
+  bsm_batch_range_t *ranges = malloc((num_ranges > 0 ? num_ranges : 1) * sizeof(bsm_batch_range_t));
+  bsm_model_t batch;
+  if (ranges == NULL) {
+    printf("Out of memory!\n");
+    return 1;
+  }
+  if (num_ranges < 0 || !bsm_batch_models(models, num_models, instances, num_instances, &batch, ranges)) {
+    printf("Failed to batch models!\n");
+    return 1;
+  }
+  
+  size_t size = bsm_layout_model(&batch);
+  if (size == 0) {
+    printf("Batch is too large!\n");
+    return 1;
+  }
+  uint8_t *data = calloc(1, size);
+  if (data == NULL) {
+    printf("Out of memory!\n");
+    return 1;
+  }
+  if (!bsm_write_model(data, size, &batch)) {
+    printf("Failed to encode batch!\n");
+    return 1;
+  }
+  FILE *file = fopen(argv[2], "wb");
+  if (file == NULL || fwrite(data, 1, size, file) != size) {
+    printf("Failed to write file!\n");
+    return 1;
+  }
+  fclose(file);
+  
+  printf("Batched %d instances of %d models: %d verts, %d triangles, %d meshes (%zu bytes)\n",
+    num_instances, num_models, batch.header.num_verts, batch.header.num_tris, batch.header.num_meshes, size);
+  printf("instance mesh idx_tris num_tris idx_vert num_vert\n");
+  for (int32_t i = 0; i < num_ranges; i++) {
+    bsm_batch_range_t *r = &ranges[i];
+    printf("%d %d %d %d %d %d\n", r->instance, r->mesh, r->idx_tris, r->num_tris, r->idx_vert, r->num_vert);
+  }
+  
+  free(data);
+  free(ranges);
+  free(instances);
+  bsm_free_model(&batch);
+  for (int32_t i = 0; i < num_models; i++) {
+    bsm_free_model(&models[i]);
+    free(paths[i]);
+  }
+  free(models);
+  free(paths);
+  return 0;
+}
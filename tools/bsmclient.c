@@ -0,0 +1,67 @@
+/* Released into the Public Domain */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <bsm_shm.h>
+#include "util.h"
+
+/* stand-in worker: maps each model through a running bsmserver and checks it against a private decode of the file */
+
+static bool same_model(bsm_model_t *a, bsm_model_t *b) {
+  bsm_header_v1_t *header = &a->header;
+  return memcmp(&a->header, &b->header, sizeof(bsm_header_v1_t)) == 0 &&
+    memcmp(a->positions, b->positions, bsm_positions_bytes(header)) == 0 &&
+    memcmp(a->texcoords, b->texcoords, bsm_texcoords_bytes(header)) == 0 &&
+    memcmp(a->normals, b->normals, bsm_normals_bytes(header)) == 0 &&
+    memcmp(a->tangents, b->tangents, bsm_tangents_bytes(header)) == 0 &&
+    memcmp(a->tris, b->tris, bsm_tris_bytes(header)) == 0 &&
+    memcmp(a->meshes, b->meshes, bsm_meshes_bytes(header)) == 0 &&
+    memcmp(a->hullverts, b->hullverts, bsm_hullverts_bytes(header)) == 0 &&
+    memcmp(a->hulls, b->hulls, bsm_hulls_bytes(header)) == 0 &&
+    memcmp(a->visverts, b->visverts, bsm_visverts_bytes(header)) == 0 &&
+    memcmp(a->vistris, b->vistris, bsm_vistris_bytes(header)) == 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    printf("Usage: bsmclient <socket> <model.bsm> [model.bsm ...]\n");
+    return 1;
+  }
+  
+  bsm_client_t *client = bsm_client_connect(argv[1]);
+  if (client == NULL) {
+    printf("Failed to connect to %s!\n", argv[1]);
+    return 1;
+  }
+  
+  int failed = 0;
+  for (int i = 2; i < argc; i++) {
+    size_t size;
+    uint8_t *data = read_file(argv[i], &size);
+    bsm_model_t local, shared;
+    if (data == NULL || !bsm_read_model(data, size, &local)) {
+      printf("%s: not a valid Binary Static Mesh!\n", argv[i]);
+      free(data);
+      failed++;
+      continue;
+    }
+    free(data);
+    
+    if (!bsm_client_acquire(client, argv[i], &shared)) {
+      printf("%s: server could not provide the model!\n", argv[i]);
+      failed++;
+    } else {
+      bool same = same_model(&local, &shared);
+      printf("%s: %d verts, %d triangles shared, %s\n", argv[i], shared.header.num_verts, shared.header.num_tris,
+        same ? "identical to local decode" : "DIFFERS from local decode");
+      failed += !same;
+      bsm_client_release(client, &shared);
+    }
+    bsm_free_model(&local);
+  }
+  
+  bsm_client_disconnect(client);
+  return failed > 0;
+}
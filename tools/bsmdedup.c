@@ -0,0 +1,69 @@
+/* Released into the Public Domain */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <bsm_dedup.h>
+#include "util.h"
+
+static const char *chunk_names[BSM_NUM_CHUNKS] = {
+  "positions", "texcoords", "normals", "tangents", "triangles",
+  "meshes", "hull verts", "hulls", "occluder verts", "occluder tris"
+};
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    printf("Usage: bsmdedup <model.bsm> [<model.bsm> ...]\n");
+    return 1;
+  }
+  
+  int32_t num_files = argc - 1;
+  bsm_dedup_file_t *files = calloc(num_files, sizeof(bsm_dedup_file_t));
+  int32_t *model = malloc(num_files * sizeof(int32_t));
+  int32_t *chunk = malloc(num_files * BSM_NUM_CHUNKS * sizeof(int32_t));
+  if (files == NULL || model == NULL || chunk == NULL) {
+    printf("Out of memory!\n");
+    return 1;
+  }
+  size_t total = 0;
+  for (int32_t i = 0; i < num_files; i++) {
+    files[i].data = read_file(argv[i + 1], &files[i].n);
+    if (files[i].data == NULL) {
+      printf("Failed to read %s!\n", argv[i + 1]);
+      return 1;
+    }
+    total += files[i].n;
+  }
+  
+  size_t saved;
+  if (!bsm_dedup_scan(files, num_files, model, chunk, &saved)) {
+    printf("Out of memory!\n");
+    return 1;
+  }
+  
+  int32_t num_dup = 0;
+  for (int32_t i = 0; i < num_files; i++) {
+    if (model[i] < 0) {
+      printf("%s: not a valid Binary Static Mesh\n", argv[i + 1]);
+    } else if (model[i] != i) {
+      printf("%s: identical to %s\n", argv[i + 1], argv[model[i] + 1]);
+      num_dup++;
+    } else {
+      for (int c = 0; c < BSM_NUM_CHUNKS; c++) {
+        int32_t j = chunk[i * BSM_NUM_CHUNKS + c];
+        bsm_header_v1_t header;
+        bsm_read_header_v1(files[i].data, files[i].n, &header);
+        if (j == i || bsm_chunk_bytes(&header, c) == 0) continue;
+        printf("%s: %s shared with %s\n", argv[i + 1], chunk_names[c], argv[j + 1]);
+      }
+    }
+  }
+  printf("%d files, %d duplicate models, %zu of %zu bytes in duplicate chunks\n", num_files, num_dup, saved, total);
+  
+  for (int32_t i = 0; i < num_files; i++) free(files[i].data);
+  free(files);
+  free(model);
+  free(chunk);
+  return 0;
+}
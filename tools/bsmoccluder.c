@@ -0,0 +1,54 @@
+/* Released into the Public Domain */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <bsm_occluder.h>
+#include "util.h"
+
+int main(int argc, char **argv) {
+  if (argc < 3 || argc > 5) {
+    printf("Usage: bsmoccluder <input.bsm> <output.bsm> [resolution = 64] [triangle budget = 240]\n");
+    return 1;
+  }
+  int32_t resolution = argc > 3 ? atoi(argv[3]) : 64;
+  int32_t max_tris   = argc > 4 ? atoi(argv[4]) : 240;
+  
+  size_t size;
+  uint8_t *data = read_file(argv[1], &size);
+  if (data == NULL) {
+    printf("Failed to read file!\n");
+    return 1;
+  }
+  
+  bsm_model_t model;
+  if (!bsm_read_model(data, size, &model)) {
+    printf("File is not a valid Binary Static Mesh!\n");
+    return 1;
+  }
+  if (!bsm_build_occluder(&model, resolution, max_tris)) {
+    printf("Failed to build occluder!\n");
+    return 1;
+  }
+  
+  size_t out_size = bsm_append_occluder_bytes(size, &model);
+  uint8_t *out = malloc(out_size);
+  if (out == NULL || !bsm_append_occluder(data, size, &model, out, out_size)) {
+    printf("Failed to encode occluder!\n");
+    return 1;
+  }
+  FILE *file = fopen(argv[2], "wb");
+  if (file == NULL || fwrite(out, 1, out_size, file) != out_size) {
+    printf("Failed to write file!\n");
+    return 1;
+  }
+  fclose(file);
+  
+  printf("Occluder: %d verts, %d triangles\n", model.header.num_visverts, model.header.num_vistris);
+  
+  free(out);
+  free(data);
+  bsm_free_model(&model);
+  return 0;
+}
@@ -0,0 +1,41 @@
+/* Released into the Public Domain */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <bsm_shm.h>
+
+static volatile sig_atomic_t running = 1;
+
+static void stop(int sig) {
+  running = 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2 || argc > 3) {
+    printf("Usage: bsmserver <socket> [cache budget in MB = 1024]\n");
+    return 1;
+  }
+  size_t budget = (size_t)(argc > 2 ? atol(argv[2]) : 1024) << 20;
+  
+  bsm_server_t *server = bsm_server_create(argv[1], budget);
+  if (server == NULL) {
+    printf("Failed to listen on %s!\n", argv[1]);
+    return 1;
+  }
+  signal(SIGINT, stop);
+  signal(SIGTERM, stop);
+  signal(SIGPIPE, SIG_IGN);
+  
+  printf("Serving models on %s\n", argv[1]);
+  fflush(stdout);
+  while (running) {
+    if (!bsm_server_poll(server, 1000)) {
+      printf("Failed to poll!\n");
+      break;
+    }
+  }
+  printf("Shutting down: %d models resident (%zu bytes)\n", bsm_server_models(server), bsm_server_bytes(server));
+  bsm_server_destroy(server);
+  return 0;
+}
@@ -0,0 +1,62 @@
+/* Released into the Public Domain */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <bsm_tile.h>
+#include "util.h"
+
+int main(int argc, char **argv) {
+  if (argc < 3 || argc > 4) {
+    printf("Usage: bsmtile <input.bsm> <output.bsm> [triangles per tile = 4096]\n");
+    return 1;
+  }
+  int32_t max_tris = argc > 3 ? atoi(argv[3]) : 4096;
+  
+  size_t size;
+  uint8_t *data = read_file(argv[1], &size);
+  if (data == NULL) {
+    printf("Failed to read file!\n");
+    return 1;
+  }
+  
+  bsm_model_t model;
+  if (!bsm_read_model(data, size, &model)) {
+    printf("File is not a valid Binary Static Mesh!\n");
+    return 1;
+  }
+  bsm_tile_t *tiles;
+  int32_t num_tiles;
+  if (!bsm_build_tiles(&model, max_tris, &tiles, &num_tiles)) {
+    printf("Failed to build tiles!\n");
+    return 1;
+  }
+  
+  bsm_header_ext_tiles_t header;
+  size_t out_size = bsm_layout_tiled_model(&model, num_tiles, &header);
+  if (out_size == 0) {
+    printf("Tiled model is too large!\n");
+    return 1;
+  }
+  uint8_t *out = calloc(1, out_size);
+  if (out == NULL || !bsm_write_tiled_model(out, out_size, &model, &header, tiles)) {
+    printf("Failed to encode tiles!\n");
+    return 1;
+  }
+  FILE *file = fopen(argv[2], "wb");
+  if (file == NULL || fwrite(out, 1, out_size, file) != out_size) {
+    printf("Failed to write file!\n");
+    return 1;
+  }
+  fclose(file);
+  
+  printf("Tiled into %d tiles: %d verts, %d triangles, %d meshes\n",
+    num_tiles, model.header.num_verts, model.header.num_tris, model.header.num_meshes);
+  
+  free(out);
+  free(tiles);
+  free(data);
+  bsm_free_model(&model);
+  return 0;
+}
@@ -0,0 +1,23 @@
+/* Released into the Public Domain */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "util.h"
+
+uint8_t *read_file(const char *path, size_t *size) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) return NULL;
+  
+  fseek(file, 0, SEEK_END);
+  long n = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  uint8_t *data = malloc(n > 0 ? n : 1);
+  if (data == NULL || n < 0 || fread(data, 1, n, file) != (size_t)n) {
+    free(data);
+    fclose(file);
+    return NULL;
+  }
+  fclose(file);
+  *size = n;
+  return data;
+}
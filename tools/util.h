@@ -0,0 +1,12 @@
+/* Released into the Public Domain */
+
+#ifndef BSM_TOOLS_UTIL_H
+#define BSM_TOOLS_UTIL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* reads a whole file into a buffer to be released with free() -- returns NULL if it cannot be read */
+uint8_t *read_file(const char *path, size_t *size);
+
+#endif /* BSM_TOOLS_UTIL_H */